@@ -0,0 +1,26 @@
+# - Find lz4
+# Find the native LZ4 includes and library
+#
+#  LZ4_INCLUDE_DIR - where to find lz4frame.h
+#  LZ4_LIBRARIES   - List of libraries when using lz4.
+#  LZ4_FOUND       - True if lz4 found.
+
+IF(LZ4_INCLUDE_DIR AND LZ4_LIBRARIES)
+  # Already in cache, be silent
+  SET(LZ4_FIND_QUIETLY TRUE)
+ENDIF(LZ4_INCLUDE_DIR AND LZ4_LIBRARIES)
+
+FIND_PATH(LZ4_INCLUDE_DIR lz4frame.h
+          PATHS "${LZ4_DIR}"
+          PATH_SUFFIXES include
+          )
+
+FIND_LIBRARY(LZ4_LIBRARIES NAMES lz4 liblz4
+             PATHS "${LZ4_DIR}"
+             PATH_SUFFIXES lib
+             )
+
+# handle the QUIETLY and REQUIRED arguments and set LZ4_FOUND to TRUE if
+# all listed variables are TRUE
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(LZ4 DEFAULT_MSG LZ4_LIBRARIES LZ4_INCLUDE_DIR)
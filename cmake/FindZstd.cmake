@@ -0,0 +1,26 @@
+# - Find zstd
+# Find the native Zstandard includes and library
+#
+#  ZSTD_INCLUDE_DIR - where to find zstd.h
+#  ZSTD_LIBRARIES   - List of libraries when using zstd.
+#  ZSTD_FOUND       - True if zstd found.
+
+IF(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARIES)
+  # Already in cache, be silent
+  SET(Zstd_FIND_QUIETLY TRUE)
+ENDIF(ZSTD_INCLUDE_DIR AND ZSTD_LIBRARIES)
+
+FIND_PATH(ZSTD_INCLUDE_DIR zstd.h
+          PATHS "${ZSTD_DIR}"
+          PATH_SUFFIXES include
+          )
+
+FIND_LIBRARY(ZSTD_LIBRARIES NAMES zstd libzstd zstd_static
+             PATHS "${ZSTD_DIR}"
+             PATH_SUFFIXES lib
+             )
+
+# handle the QUIETLY and REQUIRED arguments and set ZSTD_FOUND to TRUE if
+# all listed variables are TRUE
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(Zstd DEFAULT_MSG ZSTD_LIBRARIES ZSTD_INCLUDE_DIR)
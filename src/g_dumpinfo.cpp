@@ -395,14 +395,18 @@ CCMD(skyfog)
 
 CCMD(listsnapshots)
 {
+	size_t stored = 0, size = 0;
 	for (unsigned i = 0; i < wadlevelinfos.Size(); ++i)
 	{
 		FCompressedBuffer *snapshot = &wadlevelinfos[i].Snapshot;
 		if (snapshot->mBuffer != nullptr)
 		{
 			Printf("%s (%u -> %u bytes)\n", wadlevelinfos[i].MapName.GetChars(), snapshot->mCompressedSize, snapshot->mSize);
+			stored += snapshot->mCompressedSize;
+			size += snapshot->mSize;
 		}
 	}
+	Printf("Total: %zu bytes in memory, %zu bytes uncompressed\n", stored, size);
 }
 
 
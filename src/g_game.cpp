@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <memory>
+#include <future>
+#include <chrono>
 
 #include "i_time.h"
 #include "templates.h"
@@ -79,6 +81,7 @@
 #include "g_hub.h"
 #include "g_levellocals.h"
 #include "events.h"
+#include "ctpl.h"
 
 
 static FRandom pr_dmspawn ("DMSpawn");
@@ -95,14 +98,16 @@ void	G_DoPlayDemo (void);
 void	G_DoCompleted (void);
 void	G_DoVictory (void);
 void	G_DoWorldDone (void);
-void	G_DoSaveGame (bool okForQuicksave, FString filename, const char *description);
+void	G_DoSaveGame (bool okForQuicksave, FString filename, const char *description, bool background = false);
 void	G_DoAutoSave ();
+static void G_FinishSaveGame (bool wait);
 
 void STAT_Serialize(FSerializer &file);
 bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompressedBuffer> &content);
 
 FIntCVar gameskill ("skill", 2, CVAR_SERVERINFO|CVAR_LATCH);
 CVAR(Bool, save_formatted, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// use formatted JSON for saves (more readable but a larger files and a bit slower.
+CVAR(Bool, save_binary, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// use a binary format instead of JSON for saves (much faster on large maps but not human readable.)
 CVAR (Int, deathmatch, 0, CVAR_SERVERINFO|CVAR_LATCH);
 CVAR (Bool, chasedemo, false, 0);
 CVAR (Bool, storesavepic, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
@@ -1012,6 +1017,8 @@ void G_Ticker ()
 	int i;
 	gamestate_t	oldgamestate;
 
+	G_FinishSaveGame(false);
+
 	// do player reborns if needed
 	for (i = 0; i < MAXPLAYERS; i++)
 	{
@@ -1806,6 +1813,9 @@ void G_DoLoadGame ()
 	hidecon = gameaction == ga_loadgamehidecon;
 	gameaction = ga_nothing;
 
+	// The savegame may still be in the process of being written.
+	G_FinishSaveGame(true);
+
 	std::unique_ptr<FResourceFile> resfile(FResourceFile::OpenResourceFile(savename.GetChars(), true, true));
 	if (resfile == nullptr)
 	{
@@ -2061,7 +2071,7 @@ void G_DoAutoSave ()
 
 	readableTime = myasctime ();
 	description.Format("Autosave %s", readableTime);
-	G_DoSaveGame (false, file, description);
+	G_DoSaveGame (false, file, description, true);
 }
 
 
@@ -2166,10 +2176,142 @@ static void PutSavePic (FileWriter *file, int width, int height)
 	}
 }
 
-void G_DoSaveGame (bool okForQuicksave, FString filename, const char *description)
+//==========================================================================
+//
+// Compressing a savegame and writing it out is done on a worker thread,
+// so the game only needs to wait for its data to be collected.
+//
+//==========================================================================
+
+struct FSaveGameJob
 {
-	TArray<FCompressedBuffer> savegame_content;
-	TArray<FString> savegame_filenames;
+	FString Filename;
+	FString Description;
+	bool OkForQuicksave;
+	TArray<FString> Filenames;
+	TArray<FCompressedBuffer> Content;
+	TArray<bool> Compress;
+	TArray<bool> Owned;
+
+	FSaveGameJob(const FString &filename, const char *description, bool okForQuicksave)
+		: Filename(filename), Description(description), OkForQuicksave(okForQuicksave)
+	{
+	}
+
+	~FSaveGameJob()
+	{
+		for (unsigned i = 0; i < Content.Size(); i++)
+		{
+			if (Owned[i]) Content[i].Clean();
+		}
+	}
+
+	// Takes ownership of the buffer unless owned is false.
+	void Add(const char *name, const FCompressedBuffer &buff, bool compress, bool owned = true)
+	{
+		Filenames.Push(name);
+		Content.Push(buff);
+		Compress.Push(compress);
+		Owned.Push(owned);
+	}
+
+	bool Write()
+	{
+		for (unsigned i = 0; i < Content.Size(); i++)
+		{
+			if (Compress[i]) Content[i].Compress();
+		}
+
+		// Write to a temporary file first so that the savegame menu never sees a partially written file.
+		FString tempname = Filename + ".tmp";
+		if (!WriteZip(tempname, Filenames, Content))
+		{
+			return false;
+		}
+		// The old savegame is only replaced once the new one is complete.
+		if (!myrename(tempname, Filename))
+		{
+			remove(tempname);
+			return false;
+		}
+		return true;
+	}
+};
+
+static ctpl::thread_pool &SaveGamePool()
+{
+	static ctpl::thread_pool pool(1);
+	return pool;
+}
+
+static std::unique_ptr<FSaveGameJob> SaveGameJob;
+static std::future<bool> SaveGameResult;
+
+static FCompressedBuffer CopyBuffer(const FCompressedBuffer &buff)
+{
+	FCompressedBuffer copy = buff;
+	copy.mBuffer = new char[buff.mCompressedSize];
+	memcpy(copy.mBuffer, buff.mBuffer, buff.mCompressedSize);
+	return copy;
+}
+
+//==========================================================================
+//
+// Reports the result of the savegame being written, if there is one.
+// If wait is false this only happens when writing has finished.
+//
+//==========================================================================
+
+static void G_FinishSaveGame(bool wait)
+{
+	if (SaveGameJob == nullptr)
+	{
+		return;
+	}
+	if (!wait && SaveGameResult.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+	{
+		return;
+	}
+
+	std::unique_ptr<FSaveGameJob> job = std::move(SaveGameJob);
+	const FString &filename = job->Filename;
+	if (!SaveGameResult.get())
+	{
+		Printf(PRINT_HIGH, "%s\n", GStrings("TXT_SAVEFAILED"));
+		return;
+	}
+
+	savegameManager.NotifyNewSave (filename, job->Description, job->OkForQuicksave);
+
+	// Check whether the file is ok by trying to open it.
+	FResourceFile *test = FResourceFile::OpenResourceFile(filename, true);
+	if (test != nullptr)
+	{
+		delete test;
+		if (longsavemessages) Printf ("%s (%s)\n", GStrings("GGSAVED"), filename.GetChars());
+		else Printf ("%s\n", GStrings("GGSAVED"));
+	}
+	else Printf(PRINT_HIGH, "%s\n", GStrings("TXT_SAVEFAILED"));
+
+	BackupSaveName = filename;
+}
+
+//==========================================================================
+//
+// The savegame being written uses the hub snapshots without copying them,
+// so they may not be released or replaced until it is done.
+//
+//==========================================================================
+
+void G_WaitForSaveGame()
+{
+	G_FinishSaveGame(true);
+}
+
+void G_DoSaveGame (bool okForQuicksave, FString filename, const char *description, bool background)
+{
+	TArray<FCompressedBuffer> snapshots;
+	TArray<FString> snapshot_filenames;
 
 	char buf[100];
 
@@ -2185,13 +2327,17 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 		filename = G_BuildSaveName ("demosave." SAVEGAME_EXT, -1);
 	}
 
+	// Only one savegame can be written at a time.
+	G_FinishSaveGame(true);
+
 	if (cl_waitforsave)
 		I_FreezeTime(true);
 
+	uint64_t savestart = I_nsTime();
 	insave = true;
 	try
 	{
-		level.SnapshotLevel();
+		level.SnapshotLevel(false);
 	}
 	catch(CRecoverableError &err)
 	{
@@ -2218,7 +2364,8 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 	FSerializer savegameglobals(nullptr);	// and this for non-level related info that must be saved.
 
 	savegameinfo.OpenWriter(true);
-	savegameglobals.OpenWriter(save_formatted);
+	if (save_binary) savegameglobals.OpenBinaryWriter();
+	else savegameglobals.OpenWriter(save_formatted);
 
 	SaveVersion = SAVEVER;
 	PutSavePic(&savepic, SAVEPICWIDTH, SAVEPICHEIGHT);
@@ -2270,43 +2417,44 @@ void G_DoSaveGame (bool okForQuicksave, FString filename, const char *descriptio
 	auto picdata = savepic.GetBuffer();
 	FCompressedBuffer bufpng = { picdata->Size(), picdata->Size(), METHOD_STORED, 0, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->Size())), (char*)&(*picdata)[0] };
 
-	savegame_content.Push(bufpng);
-	savegame_filenames.Push("savepic.png");
-	savegame_content.Push(savegameinfo.GetCompressedOutput());
-	savegame_filenames.Push("info.json");
-	savegame_content.Push(savegameglobals.GetCompressedOutput());
-	savegame_filenames.Push("globals.json");
-
-	G_WriteSnapshots (savegame_filenames, savegame_content);
-	
-
-	WriteZip(filename, savegame_filenames, savegame_content);
-
-	savegameManager.NotifyNewSave (filename, description, okForQuicksave);
-
-	// delete the JSON buffers we created just above. Everything else will
-	// either still be needed or taken care of automatically.
-	savegame_content[1].Clean();
-	savegame_content[2].Clean();
+	auto job = new FSaveGameJob(filename, description, okForQuicksave);
+	job->Add("savepic.png", CopyBuffer(bufpng), false);
+	job->Add("info.json", savegameinfo.GetStoredOutput(), true);
+	job->Add("globals.json", savegameglobals.GetStoredOutput(), true);
 
-	// Check whether the file is ok by trying to open it.
-	FResourceFile *test = FResourceFile::OpenResourceFile(filename, true);
-	if (test != nullptr)
+	G_WriteSnapshots (snapshot_filenames, snapshots);
+	size_t snapshotsize = 0;
+	for (unsigned i = 0; i < snapshots.Size(); i++)
 	{
-		delete test;
-		if (longsavemessages) Printf ("%s (%s)\n", GStrings("GGSAVED"), filename.GetChars());
-		else Printf ("%s\n", GStrings("GGSAVED"));
+		snapshotsize += snapshots[i].mCompressedSize;
+		if (snapshots[i].mBuffer == level.info->Snapshot.mBuffer)
+		{
+			// The current level's snapshot was only made for this savegame so it can be handed over.
+			job->Add(snapshot_filenames[i], snapshots[i], true);
+			level.info->Snapshot.mBuffer = nullptr;
+		}
+		else
+		{
+			// The other levels' snapshots are not touched until the savegame has been written.
+			job->Add(snapshot_filenames[i], snapshots[i], false, false);
+		}
 	}
-	else Printf(PRINT_HIGH, "%s\n", GStrings("TXT_SAVEFAILED"));
-
-
-	BackupSaveName = filename;
 
 	// We don't need the snapshot any longer.
 	level.info->Snapshot.Clean();
+	DPrintf(DMSG_NOTIFY, "Savegame with %u level snapshots (%zu bytes) prepared in %.2f ms\n", snapshots.Size(), snapshotsize, (I_nsTime() - savestart) / 1e6);
+
+	SaveGameJob.reset(job);
+	SaveGameResult = SaveGamePool().push([job](int) { return job->Write(); });
 		
 	insave = false;
 
+	// Autosaves never wait for the file to be written. Other saves only do so if time is frozen for them.
+	if (cl_waitforsave && !background)
+	{
+		G_FinishSaveGame(true);
+	}
+
 	if (cl_waitforsave)
 		I_FreezeTime(false);
 }
@@ -935,6 +935,7 @@ bool FLevelLocals::DoCompleted (FString nextlevel, wbstartstruct_t &wminfo)
 		}
 		else
 		{ // Make sure we don't have a snapshot lying around from before.
+			G_WaitForSaveGame();
 			info->Snapshot.Clean();
 		}
 	}
@@ -35,6 +35,7 @@ void G_ClearSnapshots (void);
 void P_RemoveDefereds ();
 void G_ReadSnapshots (FResourceFile *);
 void G_WriteSnapshots (TArray<FString> &, TArray<FCompressedBuffer> &);
+void G_WaitForSaveGame ();	// must be called before releasing any level snapshot
 void G_WriteVisited(FSerializer &arc);
 void G_ReadVisited(FSerializer &arc);
 void G_ClearHubInfo();
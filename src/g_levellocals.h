@@ -166,7 +166,7 @@ private:
 	void SerializeSounds(FSerializer &arc);
 
 public:
-	void SnapshotLevel();
+	void SnapshotLevel(bool compress = true);
 	void UnSnapshotLevel(bool hubLoad);
 
 	void FinalizePortals();
@@ -238,6 +238,9 @@ public:
 	int m_tickCount;
 	int m_lastUpdate;
 	int mShadowmapIndex;
+	unsigned mRecordFrame;	// The hardware renderer's frame mRecord was packed for. Never reused, 0 means none.
+	int mRecordList;
+	float mRecord[16];
 	bool m_active;
 	bool visibletoplayer;
 	bool shadowmapped;
@@ -1599,6 +1599,7 @@ void vertex_t::RecalcVertexHeights()
 		}
 	}
 	if (numheights <= 2) numheights = 0;	// is not in need of any special attention
+	heightstamp++;
 	dirty = false;
 }
 
@@ -192,6 +192,7 @@ cluster_info_t *FindClusterInfo (int cluster)
 
 void G_ClearSnapshots (void)
 {
+	G_WaitForSaveGame();
 	for (unsigned int i = 0; i < wadlevelinfos.Size(); i++)
 	{
 		wadlevelinfos[i].Snapshot.Clean();
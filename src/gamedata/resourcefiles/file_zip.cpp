@@ -34,6 +34,12 @@
 */
 
 #include <time.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 #include "file_zip.h"
 #include "cmdlib.h"
 #include "templates.h"
@@ -42,6 +48,22 @@
 #include "w_zip.h"
 
 #include "ancientzip.h"
+#include "m_crc32.h"
+#include "m_misc.h"
+#include "m_argv.h"
+#include "md5.h"
+#include "gi.h"
+#include "doomstat.h"
+#include "ctpl.h"
+
+// Intentionally never destroyed because archives may still get closed during static destruction.
+static auto &PrefetchedLumps = *new std::unordered_map<FZipLump *, std::future<char *>>;
+static auto &PrefetchLock = *new std::mutex;
+
+// Archives with fewer entries than this are not worth caching, this also keeps savegames out of the cache.
+static const uint32_t MIN_INDEXCACHE_LUMPS = 1000;
+// Every combination of archive and filters gets its own file, so only this many of the most recently used are kept.
+static const unsigned MAX_INDEXCACHE_FILES = 64;
 
 #define BUFREADCOMMENT (0x400)
 
@@ -51,7 +73,7 @@
 //
 //==========================================================================
 
-static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int LumpSize, int CompressedSize, int GPFlags)
+static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int LumpSize, int CompressedSize, int GPFlags, bool quiet = false)
 {
 	try
 	{
@@ -66,6 +88,12 @@ static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int L
 		case METHOD_DEFLATE:
 		case METHOD_BZIP2:
 		case METHOD_LZMA:
+#ifdef HAVE_ZSTD
+		case METHOD_ZSTD:
+#endif
+#ifdef HAVE_LZ4
+		case METHOD_LZ4:
+#endif
 		{
 			FileReader frz;
 			if (frz.OpenDecompressor(Reader, LumpSize, Method, false))
@@ -96,7 +124,7 @@ static bool UncompressZipLump(char *Cache, FileReader &Reader, int Method, int L
 	}
 	catch (CRecoverableError &err)
 	{
-		Printf("%s\n", err.GetMessage());
+		if (!quiet) Printf("%s\n", err.GetMessage());
 		return false;
 	}
 	return true;
@@ -109,6 +137,44 @@ bool FCompressedBuffer::Decompress(char *destbuffer)
 	return UncompressZipLump(destbuffer, mr, mMethod, mSize, mCompressedSize, mZipFlags);
 }
 
+//-----------------------------------------------------------------------
+//
+// Deflates a stored buffer. If this fails or does not make the data
+// any smaller it is left as it is.
+//
+//-----------------------------------------------------------------------
+
+void FCompressedBuffer::Compress()
+{
+	if (mMethod != METHOD_STORED || mSize == 0) return;
+
+	char *compressbuf = new char[mSize];
+	z_stream stream;
+
+	stream.next_in = (Bytef *)mBuffer;
+	stream.avail_in = mSize;
+	stream.next_out = (Bytef *)compressbuf;
+	stream.avail_out = mSize;
+	stream.zalloc = (alloc_func)0;
+	stream.zfree = (free_func)0;
+	stream.opaque = (voidpf)0;
+
+	// create output in zip-compatible form
+	if (deflateInit2(&stream, 8, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY) == Z_OK)
+	{
+		int err = deflate(&stream, Z_FINISH);
+		if (deflateEnd(&stream) == Z_OK && err == Z_STREAM_END)
+		{
+			delete[] mBuffer;
+			mCompressedSize = (unsigned)stream.total_out;
+			mBuffer = new char[mCompressedSize];
+			memcpy(mBuffer, compressbuf, mCompressedSize);
+			mMethod = METHOD_DEFLATE;
+		}
+	}
+	delete[] compressbuf;
+}
+
 //-----------------------------------------------------------------------
 //
 // Finds the central directory end record in the end of the file.
@@ -206,6 +272,18 @@ bool FZipFile::Open(bool quiet)
 	Reader.Seek(LittleLong(info.DirectoryOffset), FileReader::SeekSet);
 	Reader.Read(directory, dirsize);
 
+	// For large archives try to get the final lump table from the index cache
+	// instead of parsing and sorting the entire directory again.
+	static const bool noindexcache = !!Args->CheckParm("-noindexcache");
+	bool useindexcache = !noindexcache && NumLumps >= MIN_INDEXCACHE_LUMPS;
+	uint32_t dircrc = useindexcache ? CalcCRC32((const uint8_t*)directory, dirsize) : 0;
+	if (useindexcache && LoadIndexCache(dircrc, NumLumps))
+	{
+		free(directory);
+		if (!quiet && !batchrun) Printf(TEXTCOLOR_NORMAL ", %d lumps\n", NumLumps);
+		return true;
+	}
+
 	char *dirptr = (char*)directory;
 	FZipLump *lump_p = Lumps;
 
@@ -317,6 +395,12 @@ bool FZipFile::Open(bool quiet)
 			zip_fh->Method != METHOD_DEFLATE &&
 			zip_fh->Method != METHOD_LZMA &&
 			zip_fh->Method != METHOD_BZIP2 &&
+#ifdef HAVE_ZSTD
+			zip_fh->Method != METHOD_ZSTD &&
+#endif
+#ifdef HAVE_LZ4
+			zip_fh->Method != METHOD_LZ4 &&
+#endif
 			zip_fh->Method != METHOD_IMPLODE &&
 			zip_fh->Method != METHOD_SHRINK)
 		{
@@ -341,7 +425,7 @@ bool FZipFile::Open(bool quiet)
 		lump_p->Owner = this;
 		// The start of the Reader will be determined the first time it is accessed.
 		lump_p->Flags = LUMPF_ZIPFILE | LUMPFZIP_NEEDFILESTART;
-		lump_p->Method = uint8_t(zip_fh->Method);
+		lump_p->Method = zip_fh->Method;
 		if (lump_p->Method != METHOD_STORED) lump_p->Flags |= LUMPF_COMPRESSED;
 		lump_p->GPFlags = zip_fh->Flags;
 		lump_p->CRC32 = zip_fh->CRC32;
@@ -364,9 +448,215 @@ bool FZipFile::Open(bool quiet)
 	if (!quiet && !batchrun) Printf(TEXTCOLOR_NORMAL ", %d lumps\n", NumLumps);
 	
 	PostProcessArchive(&Lumps[0], sizeof(FZipLump));
+	if (useindexcache) SaveIndexCache(dircrc);
 	return true;
 }
 
+//==========================================================================
+//
+// Index cache
+//
+// Stores the fully processed lump table of a large archive, so that the
+// next launch can skip name setup, sorting and filtering.
+// The cache is only used if the file's size and modification time and the
+// central directory's CRC are unchanged and the same filters are active.
+// Archives get opened with different filters during startup, e.g. before
+// the game type is known, so each set of filters gets its own cache file.
+//
+//==========================================================================
+
+static const char IndexCacheMagic[4] = { 'Z', 'D', 'Z', 'I' };
+static const uint32_t IndexCacheVersion = 2;
+
+FString FZipFile::GetIndexCacheName(bool create)
+{
+	uint8_t digest[16];
+	MD5Context md5;
+	int32_t gametype = gameinfo.gametype;
+	md5.Update((const uint8_t *)FileName.GetChars(), (unsigned int)FileName.Len());
+	md5.Update((const uint8_t *)&gametype, sizeof(gametype));
+	md5.Update((const uint8_t *)LumpFilterIWAD.GetChars(), (unsigned int)LumpFilterIWAD.Len());
+	md5.Final(digest);
+
+	FString path = M_GetCachePath(create);
+	path << "/indexcache";
+	if (create) CreatePath(path);
+	path << '/';
+	for (int i = 0; i < 16; i++) path.AppendFormat("%02x", digest[i]);
+	path << ".zdzi";
+	return path;
+}
+
+bool FZipFile::LoadIndexCache(uint32_t dircrc, uint32_t maxlumps)
+{
+	size_t filesize;
+	time_t filetime;
+	if (!GetFileInfo(FileName, &filesize, &filetime) || (FileReader::Size)filesize != Reader.GetLength())
+		return false;	// not a plain file on disk
+
+	FString cachename = GetIndexCacheName(false);
+	FileReader fr;
+	if (!fr.OpenFile(cachename))
+		return false;
+
+	auto data = fr.Read();
+	const uint8_t *p = data.Data();
+	const uint8_t *end = p + data.Size();
+	auto get = [&](void *dest, size_t size)
+	{
+		if (p + size > end) return false;
+		memcpy(dest, p, size);
+		p += size;
+		return true;
+	};
+
+	char magic[4];
+	uint32_t version, crc, count, filterlen;
+	uint64_t size, time;
+	int32_t gametype;
+	if (!get(magic, 4) || memcmp(magic, IndexCacheMagic, 4) || !get(&version, 4) || version != IndexCacheVersion ||
+		!get(&size, 8) || size != filesize || !get(&time, 8) || time != (uint64_t)filetime ||
+		!get(&crc, 4) || crc != dircrc || !get(&gametype, 4) || gametype != (int32_t)gameinfo.gametype ||
+		!get(&filterlen, 4) || filterlen != LumpFilterIWAD.Len() || p + filterlen > end || memcmp(p, LumpFilterIWAD.GetChars(), filterlen))
+	{
+		return false;
+	}
+	p += filterlen;
+	if (!get(&count, 4) || count > maxlumps)
+		return false;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		FZipLump *lump_p = &Lumps[i];
+		uint16_t namelen;
+		int32_t ns;
+		if (!get(&namelen, 2) || p + namelen > end)
+			break;
+		lump_p->FullName = FString((const char *)p, namelen);
+		p += namelen;
+		if (!get(lump_p->Name, 8) || !get(&ns, 4) || !get(&lump_p->Flags, 1) || !get(&lump_p->LumpSize, 4) || !get(&lump_p->Method, 2) ||
+			!get(&lump_p->GPFlags, 2) || !get(&lump_p->CRC32, 4) || !get(&lump_p->CompressedSize, 4) || !get(&lump_p->Position, 4))
+			break;
+		lump_p->Name[8] = 0;
+		lump_p->Namespace = ns;
+		lump_p->Owner = this;
+		if (i == count - 1)
+		{
+			NumLumps = count;
+			// Mark the file as recently used so that pruning keeps it.
+			fr.Close();
+			TouchFile(cachename);
+			return true;
+		}
+	}
+
+	// The cache file is truncated. Start over with a clean lump table.
+	delete[] Lumps;
+	Lumps = new FZipLump[NumLumps];
+	return false;
+}
+
+void FZipFile::SaveIndexCache(uint32_t dircrc)
+{
+	size_t filesize;
+	time_t filetime;
+	if (NumLumps == 0 || !GetFileInfo(FileName, &filesize, &filetime) || (FileReader::Size)filesize != Reader.GetLength())
+		return;
+
+	TArray<uint8_t> data;
+	auto put = [&](const void *src, size_t size)
+	{
+		memcpy(&data[data.Reserve((unsigned)size)], src, size);
+	};
+
+	uint64_t size = filesize, time = (uint64_t)filetime;
+	int32_t gametype = gameinfo.gametype;
+	uint32_t filterlen = (uint32_t)LumpFilterIWAD.Len();
+	put(IndexCacheMagic, 4);
+	put(&IndexCacheVersion, 4);
+	put(&size, 8);
+	put(&time, 8);
+	put(&dircrc, 4);
+	put(&gametype, 4);
+	put(&filterlen, 4);
+	if (filterlen > 0) put(LumpFilterIWAD.GetChars(), filterlen);
+	put(&NumLumps, 4);
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		const FZipLump *lump_p = &Lumps[i];
+		uint16_t namelen = (uint16_t)lump_p->FullName.Len();
+		int32_t ns = lump_p->Namespace;
+		put(&namelen, 2);
+		if (namelen > 0) put(lump_p->FullName.GetChars(), namelen);
+		put(lump_p->Name, 8);
+		put(&ns, 4);
+		put(&lump_p->Flags, 1);
+		put(&lump_p->LumpSize, 4);
+		put(&lump_p->Method, 2);
+		put(&lump_p->GPFlags, 2);
+		put(&lump_p->CRC32, 4);
+		put(&lump_p->CompressedSize, 4);
+		put(&lump_p->Position, 4);
+	}
+
+	// Write to a temporary file first so that a crash cannot leave a truncated cache behind.
+	FString name = GetIndexCacheName(true);
+	FString tempname = name + ".tmp";
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(tempname));
+	if (fw)
+	{
+		bool ok = fw->Write(data.Data(), data.Size()) == data.Size();
+		fw.reset();
+		if (!ok || !myrename(tempname, name))
+		{
+			remove(tempname);
+		}
+	}
+	PruneIndexCache();
+}
+
+//==========================================================================
+//
+// Deletes the least recently used cache files beyond MAX_INDEXCACHE_FILES.
+//
+//==========================================================================
+
+void FZipFile::PruneIndexCache()
+{
+	struct FCacheFile
+	{
+		FString Name;
+		time_t Time;
+	};
+
+	FString dir = M_GetCachePath(false);
+	dir << "/indexcache";
+	if (!DirExists(dir)) return;
+
+	TArray<FFileList> list;
+	TArray<FCacheFile> files;
+	ScanDirectory(list, dir);
+	for (auto &entry : list)
+	{
+		FCacheFile file;
+		size_t size;
+		if (!entry.isDirectory && entry.Filename.Right(5).CompareNoCase(".zdzi") == 0 && GetFileInfo(entry.Filename, &size, &file.Time))
+		{
+			file.Name = entry.Filename;
+			files.Push(file);
+		}
+	}
+
+	if (files.Size() > MAX_INDEXCACHE_FILES)
+	{
+		std::sort(files.begin(), files.end(), [](const FCacheFile &a, const FCacheFile &b) { return a.Time > b.Time; });
+		for (unsigned i = MAX_INDEXCACHE_FILES; i < files.Size(); i++)
+		{
+			remove(files[i].Name);
+		}
+	}
+}
+
 //==========================================================================
 //
 // Zip file
@@ -375,6 +665,7 @@ bool FZipFile::Open(bool quiet)
 
 FZipFile::~FZipFile()
 {
+	FZipLump::DiscardPrefetched(this);
 	if (Lumps != NULL) delete [] Lumps;
 }
 
@@ -452,6 +743,28 @@ int FZipLump::FillCache()
 		return -1;
 	}
 
+	std::future<char *> pending;
+	{
+		std::lock_guard<std::mutex> lock(PrefetchLock);
+		auto it = PrefetchedLumps.find(this);
+		if (it != PrefetchedLumps.end())
+		{
+			pending = std::move(it->second);
+			PrefetchedLumps.erase(it);
+		}
+	}
+	if (pending.valid())
+	{
+		char *data = pending.get();
+		if (data != nullptr)
+		{
+			Cache = data;
+			RefCount = 1;
+			return 1;
+		}
+		// If the background job failed, do it again here to report the error.
+	}
+
 	Owner->Reader.Seek(Position, FileReader::SeekSet);
 	Cache = new char[LumpSize];
 	UncompressZipLump(Cache, Owner->Reader, Method, LumpSize, CompressedSize, GPFlags);
@@ -459,6 +772,103 @@ int FZipLump::FillCache()
 	return 1;
 }
 
+//==========================================================================
+//
+// Background decompression
+//
+// Prefetch hands a compressed lump to a worker pool so that many lumps
+// can be inflated in parallel while the main thread does something else.
+// The next FillCache picks up the result, or waits for it if the job
+// hasn't finished yet. The worker never touches the archive's reader:
+// the compressed data is either read up front or, for memory mapped
+// archives, accessed directly.
+//
+// Lumps also get read by the texture worker threads, so the list of
+// pending jobs is guarded by PrefetchLock. Prefetch itself reads from the
+// archive and must only be called from the main thread.
+//
+//==========================================================================
+
+static ctpl::thread_pool &PrefetchPool()
+{
+	static ctpl::thread_pool pool(MAX(1, (int)std::thread::hardware_concurrency() - 1));
+	return pool;
+}
+
+bool FZipLump::Prefetch()
+{
+	if (Method == METHOD_STORED || Cache != nullptr || LumpSize <= 0)
+		return false;
+	{
+		std::lock_guard<std::mutex> lock(PrefetchLock);
+		if (PrefetchedLumps.count(this)) return false;
+	}
+
+	if (Flags & LUMPFZIP_NEEDFILESTART) SetLumpAddress();
+
+	const char *buffer = Owner->Reader.GetBuffer();
+	char *compressed = nullptr;
+	if (buffer == nullptr)
+	{
+		compressed = new char[CompressedSize];
+		Owner->Reader.Seek(Position, FileReader::SeekSet);
+		if (Owner->Reader.Read(compressed, CompressedSize) != CompressedSize)
+		{
+			delete[] compressed;
+			return false;
+		}
+		buffer = compressed;
+	}
+	else buffer += Position;
+
+	int method = Method, lumpsize = LumpSize, compressedsize = CompressedSize, gpflags = GPFlags;
+	auto job = PrefetchPool().push([=](int) -> char *
+	{
+		FileReader mr;
+		mr.OpenMemory(buffer, compressedsize);
+		char *data = new char[lumpsize];
+		if (!UncompressZipLump(data, mr, method, lumpsize, compressedsize, gpflags, true))
+		{
+			delete[] data;
+			data = nullptr;
+		}
+		delete[] compressed;
+		return data;
+	});
+	std::lock_guard<std::mutex> lock(PrefetchLock);
+	PrefetchedLumps[this] = std::move(job);
+	return true;
+}
+
+//==========================================================================
+//
+// Throws away prefetched data nobody asked for, either for one archive
+// that is about to be closed or for all of them.
+//
+//==========================================================================
+
+void FZipLump::DiscardPrefetched(FResourceFile *owner)
+{
+	std::vector<std::future<char *>> discarded;
+	{
+		std::lock_guard<std::mutex> lock(PrefetchLock);
+		for (auto it = PrefetchedLumps.begin(); it != PrefetchedLumps.end();)
+		{
+			if (owner == nullptr || it->first->Owner == owner)
+			{
+				discarded.push_back(std::move(it->second));
+				it = PrefetchedLumps.erase(it);
+			}
+			else ++it;
+		}
+	}
+	// Wait outside the lock so that readers of other lumps are not held up.
+	for (auto &job : discarded)
+	{
+		delete[] job.get();
+	}
+}
+
 //==========================================================================
 //
 //
@@ -612,11 +1022,16 @@ int AppendCentralDirectory(FileWriter *zip_file, const char *filename, FCompress
 bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompressedBuffer> &content)
 {
 	// try to determine local time
-	struct tm *ltime;
+	// Savegames are written on a worker thread, so this must not use localtime's static buffer.
+	struct tm ltime;
 	time_t ttime;
 	ttime = time(nullptr);
-	ltime = localtime(&ttime);
-	auto dostime = time_to_dos(ltime);
+#ifdef _WIN32
+	localtime_s(&ltime, &ttime);
+#else
+	localtime_r(&ttime, &ltime);
+#endif
+	auto dostime = time_to_dos(&ltime);
 
 	TArray<int> positions;
 
@@ -17,13 +17,17 @@ enum
 struct FZipLump : public FResourceLump
 {
 	uint16_t	GPFlags;
-	uint8_t	Method;
+	uint16_t	Method;
 	int		CompressedSize;
 	int		Position;
 	unsigned CRC32;
 
 	virtual FileReader *GetReader();
 	virtual int FillCache();
+	virtual bool Prefetch();
+	virtual bool GetCRC32(uint32_t &crc) const { crc = LittleLong(CRC32); return true; }
+
+	static void DiscardPrefetched(FResourceFile *owner = nullptr);
 
 private:
 	void SetLumpAddress();
@@ -42,6 +46,11 @@ class FZipFile : public FResourceFile
 {
 	FZipLump *Lumps;
 
+	FString GetIndexCacheName(bool create);
+	bool LoadIndexCache(uint32_t dircrc, uint32_t maxlumps);
+	void SaveIndexCache(uint32_t dircrc);
+	static void PruneIndexCache();
+
 public:
 	FZipFile(const char * filename, FileReader &file);
 	virtual ~FZipFile();
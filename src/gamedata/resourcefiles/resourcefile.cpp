@@ -35,9 +35,11 @@
 */
 
 #include <zlib.h>
+#include <mutex>
 #include "resourcefile.h"
 #include "cmdlib.h"
 #include "w_wad.h"
+#include "cachebudget.h"
 #include "gi.h"
 #include "doomstat.h"
 
@@ -75,14 +77,93 @@ public:
 
 FResourceLump::~FResourceLump()
 {
-	if (Cache != NULL && RefCount >= 0)
+	if (Cache != NULL && RefCount >= 0 && ContentAlias == NULL)
 	{
-		delete [] Cache;
-		Cache = NULL;
+		std::lock_guard<std::mutex> lock(LRULock);
+		FreeCache();
 	}
 	Owner = NULL;
 }
 
+//==========================================================================
+//
+// List of lumps whose last reference is gone but whose cache is kept
+// around as long as the cache budget allows. The head is the one that
+// was released the longest time ago.
+//
+// Lumps are cached and released by the texture upload and init workers
+// too, so the list, the reference counts of cached lumps and the cache
+// pointers are only changed while holding LRULock. Filling a cache happens
+// outside the lock so that workers can decompress in parallel.
+//
+//==========================================================================
+
+std::mutex FResourceLump::LRULock;
+static FResourceLump *LRUHead, *LRUTail;
+
+static void LinkLRU(FResourceLump *lump)
+{
+	lump->LRUPrev = LRUTail;
+	lump->LRUNext = nullptr;
+	if (LRUTail != nullptr) LRUTail->LRUNext = lump;
+	else LRUHead = lump;
+	LRUTail = lump;
+}
+
+static void UnlinkLRU(FResourceLump *lump)
+{
+	if (lump->LRUPrev == nullptr && LRUHead != lump) return;	// not in the list
+	if (lump->LRUPrev != nullptr) lump->LRUPrev->LRUNext = lump->LRUNext;
+	else LRUHead = lump->LRUNext;
+	if (lump->LRUNext != nullptr) lump->LRUNext->LRUPrev = lump->LRUPrev;
+	else LRUTail = lump->LRUPrev;
+	lump->LRUPrev = lump->LRUNext = nullptr;
+}
+
+void TrimLumpCache()
+{
+	std::lock_guard<std::mutex> lock(FResourceLump::LRULock);
+	FResourceLump::TrimLRU();
+}
+
+void FResourceLump::TrimLRU()
+{
+	while (LRUHead != nullptr && (CacheBudget() == 0 || CacheOverBudget()))
+	{
+		LRUHead->FreeCache();
+		CacheEvictions[CACHE_Lumps]++;
+	}
+}
+
+//==========================================================================
+//
+// Frees the cache, which must be owned by this lump. LRULock must be held.
+//
+//==========================================================================
+
+void FResourceLump::FreeCache()
+{
+	if (RefCount == 0) UnlinkLRU(this);
+	delete [] Cache;
+	Cache = NULL;
+	RefCount = 0;
+	CacheResident[CACHE_Lumps] -= LumpSize;
+}
+
+//==========================================================================
+//
+// Frees a cache that was kept around after its last release.
+//
+//==========================================================================
+
+bool FResourceLump::FreeUnusedCache()
+{
+	std::lock_guard<std::mutex> lock(LRULock);
+	if (Cache == NULL || RefCount != 0 || ContentAlias != NULL) return false;
+	FreeCache();
+	return true;
+}
+
 
 //==========================================================================
 //
@@ -239,31 +320,63 @@ FileReader FResourceLump::NewReader()
 
 void *FResourceLump::CacheLump()
 {
-	if (Cache != NULL)
+	if (ContentAlias != NULL)
 	{
-		if (RefCount > 0) RefCount++;
+		// The data is identical to another lump's so use that one's cache.
+		Cache = (char*)ContentAlias->CacheLump();
 	}
-	else if (LumpSize > 0)
+	else
 	{
-		FillCache();
+		std::unique_lock<std::mutex> lock(LRULock);
+		if (Cache != NULL)
+		{
+			if (RefCount > 0) RefCount++;
+			else if (RefCount == 0)
+			{
+				// Still around from an earlier use, so it doesn't need to be loaded again.
+				UnlinkLRU(this);
+				RefCount = 1;
+			}
+		}
+		else if (LumpSize > 0)
+		{
+			lock.unlock();
+			FillCache();
+			if (RefCount > 0) CacheResident[CACHE_Lumps] += LumpSize;
+		}
 	}
 	return Cache;
 }
 
 //==========================================================================
 //
-// Decrements reference counter and frees lump if counter reaches 0
+// Decrements reference counter. When it reaches 0 the cache is either
+// freed or, if the cache budget allows, kept for later.
 //
 //==========================================================================
 
 int FResourceLump::ReleaseCache()
 {
+	if (ContentAlias != NULL)
+	{
+		int count = ContentAlias->ReleaseCache();
+		if (count == 0) Cache = NULL;
+		return count;
+	}
+	std::lock_guard<std::mutex> lock(LRULock);
 	if (LumpSize > 0 && RefCount > 0)
 	{
 		if (--RefCount == 0)
 		{
-			delete [] Cache;
-			Cache = NULL;
+			if (CacheBudget() > 0)
+			{
+				LinkLRU(this);
+				TrimLRU();
+			}
+			else
+			{
+				FreeCache();
+			}
 		}
 	}
 	return RefCount;
@@ -3,6 +3,7 @@
 #ifndef __RESFILE_H
 #define __RESFILE_H
 
+#include <mutex>
 #include "files.h"
 
 class FResourceFile;
@@ -19,6 +20,7 @@ struct FCompressedBuffer
 	char *mBuffer;
 
 	bool Decompress(char *destbuffer);
+	void Compress();
 	void Clean()
 	{
 		mSize = mCompressedSize = 0;
@@ -46,6 +48,9 @@ struct FResourceLump
 	uint8_t			Flags;
 	int8_t			RefCount;
 	char *			Cache;
+	FResourceLump *	ContentAlias;	// another lump with identical data whose cache this one shares
+	FResourceLump *	LRUPrev;		// links unreferenced lumps whose cache is kept around
+	FResourceLump *	LRUNext;
 	FResourceFile *	Owner;
 	FTexture *		LinkedTexture;
 	int				Namespace;
@@ -53,6 +58,8 @@ struct FResourceLump
 	FResourceLump()
 	{
 		Cache = NULL;
+		ContentAlias = NULL;
+		LRUPrev = LRUNext = NULL;
 		Owner = NULL;
 		Flags = 0;
 		RefCount = 0;
@@ -69,13 +76,22 @@ struct FResourceLump
 	void LumpNameSetup(FString iname);
 	void CheckEmbedded();
 	virtual FCompressedBuffer GetRawData();
+	virtual bool Prefetch() { return false; }	// starts decompressing the lump in the background, if supported
+	virtual bool GetCRC32(uint32_t &crc) const { return false; }	// only succeeds if the container stores one
 
 	void *CacheLump();
 	int ReleaseCache();
+	bool FreeUnusedCache();
 
 protected:
 	virtual int FillCache() = 0;
 
+private:
+	static std::mutex LRULock;		// guards the list of kept caches, see resourcefile.cpp
+	static void TrimLRU();
+	void FreeCache();
+
+	friend void TrimLumpCache();
 };
 
 class FResourceFile
@@ -36,6 +36,11 @@
 #include "r_data/r_translate.h"
 #include "r_data/colormaps.h"
 
+#if !defined(NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define BITMAP_SSE2
+#endif
+
 
 //===========================================================================
 // 
@@ -212,6 +217,90 @@ static const CopyFunc copyfuncs[][11]={
 };
 #undef COPY_FUNCS
 
+#ifdef BITMAP_SSE2
+//===========================================================================
+//
+// SSE2 versions of the most common unblended copies. These are what
+// texture loading spends most of its time in and produce the same
+// output as iCopyColors<..., cBGRA, bCopy>, i.e. pixels with an alpha
+// of 0 leave the destination untouched.
+//
+//===========================================================================
+
+static inline __m128i MaskedPixels(__m128i src, __m128i dest)
+{
+	__m128i transparent = _mm_cmpeq_epi32(_mm_and_si128(src, _mm_set1_epi32(0xff000000)), _mm_setzero_si128());
+	return _mm_or_si128(_mm_and_si128(transparent, dest), _mm_andnot_si128(transparent, src));
+}
+
+static void CopyRowBGRA_SSE2(uint8_t *pout, const uint8_t *pin, int count)
+{
+	int i = 0;
+	for (; i + 4 <= count; i += 4, pout += 16, pin += 16)
+	{
+		__m128i src = _mm_loadu_si128((const __m128i *)pin);
+		__m128i dest = _mm_loadu_si128((const __m128i *)pout);
+		_mm_storeu_si128((__m128i *)pout, MaskedPixels(src, dest));
+	}
+	iCopyColors<cBGRA, cBGRA, bCopy>(pout, pin, count - i, 4, nullptr, 0, 0, 0);
+}
+
+static void CopyRowRGBA_SSE2(uint8_t *pout, const uint8_t *pin, int count)
+{
+	const __m128i ga = _mm_set1_epi32(0xff00ff00);
+	const __m128i lowbyte = _mm_set1_epi32(0xff);
+	int i = 0;
+	for (; i + 4 <= count; i += 4, pout += 16, pin += 16)
+	{
+		__m128i src = _mm_loadu_si128((const __m128i *)pin);
+		__m128i r = _mm_and_si128(src, lowbyte);
+		__m128i b = _mm_and_si128(_mm_srli_epi32(src, 16), lowbyte);
+		src = _mm_or_si128(_mm_and_si128(src, ga), _mm_or_si128(_mm_slli_epi32(r, 16), b));
+		__m128i dest = _mm_loadu_si128((const __m128i *)pout);
+		_mm_storeu_si128((__m128i *)pout, MaskedPixels(src, dest));
+	}
+	iCopyColors<cRGBA, cBGRA, bCopy>(pout, pin, count - i, 4, nullptr, 0, 0, 0);
+}
+
+static void CopyRowIA_SSE2(uint8_t *pout, const uint8_t *pin, int count)
+{
+	const __m128i lowbyte = _mm_set1_epi32(0xff);
+	int i = 0;
+	for (; i + 4 <= count; i += 4, pout += 16, pin += 8)
+	{
+		__m128i ia = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)pin), _mm_setzero_si128());
+		__m128i gray = _mm_and_si128(ia, lowbyte);
+		__m128i alpha = _mm_slli_epi32(_mm_srli_epi32(ia, 8), 24);
+		gray = _mm_or_si128(gray, _mm_or_si128(_mm_slli_epi32(gray, 8), _mm_slli_epi32(gray, 16)));
+		__m128i dest = _mm_loadu_si128((const __m128i *)pout);
+		_mm_storeu_si128((__m128i *)pout, MaskedPixels(_mm_or_si128(gray, alpha), dest));
+	}
+	iCopyColors<cIA, cBGRA, bCopy>(pout, pin, count - i, 2, nullptr, 0, 0, 0);
+}
+
+static void CopyRowRGB_SSE2(uint8_t *pout, const uint8_t *pin, int count)
+{
+	// There is no byte shuffle in SSE2, so this just writes whole pixels at once.
+	uint32_t *out = (uint32_t *)pout;
+	for (int i = 0; i < count; i++, pin += 3)
+	{
+		out[i] = 0xff000000u | (pin[0] << 16) | (pin[1] << 8) | pin[2];
+	}
+}
+
+static bool CopyRowFast(uint8_t *pout, const uint8_t *pin, int count, int step, int ct)
+{
+	switch (ct)
+	{
+	case CF_BGRA:	if (step != 4) return false; CopyRowBGRA_SSE2(pout, pin, count);	return true;
+	case CF_RGBA:	if (step != 4) return false; CopyRowRGBA_SSE2(pout, pin, count);	return true;
+	case CF_IA:		if (step != 2) return false; CopyRowIA_SSE2(pout, pin, count);		return true;
+	case CF_RGB:	if (step != 3) return false; CopyRowRGB_SSE2(pout, pin, count);		return true;
+	default:		return false;
+	}
+}
+#endif
+
 //===========================================================================
 //
 // Clips the copy area for CopyPixelData functions
@@ -377,6 +466,16 @@ void FBitmap::CopyPixelDataRGB(int originx, int originy, const uint8_t *patch, i
 	if (ClipCopyPixelRect(&ClipRect, originx, originy, patch, srcwidth, srcheight, step_x, step_y, rotate))
 	{
 		uint8_t *buffer = data + 4 * originx + Pitch * originy;
+#ifdef BITMAP_SSE2
+		if (inf == NULL && CopyRowFast(buffer, patch, srcwidth, step_x, ct))
+		{
+			for (int y = 1; y < srcheight; y++)
+			{
+				CopyRowFast(&buffer[y*Pitch], &patch[y*step_y], srcwidth, step_x, ct);
+			}
+			return;
+		}
+#endif
 		int op = inf==NULL? OP_COPY : inf->op;
 		for (int y=0;y<srcheight;y++)
 		{
@@ -456,6 +555,23 @@ void FBitmap::CopyPixelData(int originx, int originy, const uint8_t * patch, int
 			}
 		}
 
+#ifdef BITMAP_SSE2
+		if (inf == NULL && step_x == 1)
+		{
+			// PalEntry has the same memory layout as a BGRA pixel here.
+			for (int y = 0; y < srcheight; y++)
+			{
+				uint32_t *out = (uint32_t *)&buffer[y*Pitch];
+				const uint8_t *in = &patch[y*step_y];
+				for (int x = 0; x < srcwidth; x++)
+				{
+					PalEntry pe = palette[in[x]];
+					if (pe.a) out[x] = pe.d;
+				}
+			}
+			return;
+		}
+#endif
 		copypalettedfuncs[inf==NULL? OP_COPY : inf->op](buffer, patch, srcwidth, srcheight, Pitch, 
 														step_x, step_y, rotate, palette, inf);
 	}
@@ -44,6 +44,13 @@
 #include "xbr/xbrz_old.h"
 #include "parallel_for.h"
 #include "hwrenderer/textures/hw_material.h"
+#include "cmdlib.h"
+#include "m_misc.h"
+#include "md5.h"
+#include "files.h"
+#include "ctpl.h"
+#include <algorithm>
+#include <atomic>
 
 EXTERN_CVAR(Int, gl_texture_hqresizemult)
 CUSTOM_CVAR(Int, gl_texture_hqresizemode, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
@@ -80,6 +87,8 @@ CVAR (Flag, gl_texture_hqresize_sprites, gl_texture_hqresize_targets, 2);
 CVAR (Flag, gl_texture_hqresize_fonts, gl_texture_hqresize_targets, 4);
 
 CVAR(Bool, gl_texture_hqresize_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR(Bool, gl_texture_hqresize_diskcache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR(Int, gl_texture_hqresize_diskcachesize, 1024, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);	// in megabytes
 
 CUSTOM_CVAR(Int, gl_texture_hqresize_mt_width, 16, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 {
@@ -191,6 +200,41 @@ static void scale4x ( uint32_t* inputBuffer, uint32_t* outputBuffer, int inWidth
 	delete[] buffer2x;
 }
 
+//===========================================================================
+//
+// Runs a scaler that only works on whole images on horizontal slices of
+// the input on multiple threads. Each slice gets a few extra rows on both
+// sides so that the scaler sees the same neighborhood as for the full
+// image. The output for these extra rows is discarded.
+//
+//===========================================================================
+
+template<class Scaler>
+static void ScaleSlices(const int N, uint32_t *inputBuffer, uint32_t *outputBuffer, const int inWidth, const int inHeight, const Scaler &scaler)
+{
+	// scale4x is scale2x applied twice, so it needs two rows of context.
+	enum { SLICE_CONTEXT = 2 };
+	const int sliceHeight = MAX<int>(gl_texture_hqresize_mt_height, 4 * SLICE_CONTEXT);
+
+	if (!gl_texture_hqresize_multithread || inWidth <= gl_texture_hqresize_mt_width || inHeight <= sliceHeight)
+	{
+		scaler(inputBuffer, outputBuffer, inHeight);
+		return;
+	}
+
+	const int outWidth = N * inWidth;
+	parallel_for(inHeight, sliceHeight, [=, &scaler](int sliceY)
+	{
+		const int first = MAX(sliceY - SLICE_CONTEXT, 0);
+		const int last = MIN(sliceY + sliceHeight + SLICE_CONTEXT, inHeight);
+		const int rows = MIN(sliceHeight, inHeight - sliceY);
+
+		TArray<uint32_t> slice(outWidth * N * (last - first), true);
+		scaler(inputBuffer + first * inWidth, slice.Data(), last - first);
+		memcpy(outputBuffer + sliceY * N * outWidth, slice.Data() + (sliceY - first) * N * outWidth, rows * N * outWidth * 4);
+	});
+}
+
 static unsigned char *scaleNxHelper( void (*scaleNxFunction) ( uint32_t* , uint32_t* , int , int),
 							  const int N,
 							  unsigned char *inputBuffer,
@@ -203,7 +247,8 @@ static unsigned char *scaleNxHelper( void (*scaleNxFunction) ( uint32_t* , uint3
 	outHeight = N *inHeight;
 	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
 
-	scaleNxFunction ( reinterpret_cast<uint32_t*> ( inputBuffer ), reinterpret_cast<uint32_t*> ( newBuffer ), inWidth, inHeight );
+	ScaleSlices(N, reinterpret_cast<uint32_t*>(inputBuffer), reinterpret_cast<uint32_t*>(newBuffer), inWidth, inHeight,
+		[=](uint32_t *src, uint32_t *dest, int rows) { scaleNxFunction(src, dest, inWidth, rows); });
 	delete[] inputBuffer;
 	return newBuffer;
 }
@@ -241,7 +286,8 @@ static unsigned char *normalNxHelper( void (normalNxFunction) ( uint32_t* , uint
 	outHeight = N *inHeight;
 	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
 
-	normalNxFunction ( reinterpret_cast<uint32_t*> ( inputBuffer ), reinterpret_cast<uint32_t*> ( newBuffer ), inWidth, inHeight, N );
+	ScaleSlices(N, reinterpret_cast<uint32_t*>(inputBuffer), reinterpret_cast<uint32_t*>(newBuffer), inWidth, inHeight,
+		[=](uint32_t *src, uint32_t *dest, int rows) { normalNxFunction(src, dest, inWidth, rows, N); });
 	delete[] inputBuffer;
 	return newBuffer;
 }
@@ -271,7 +317,8 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 	cImageIn.Convert32To17();
 
 	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
-	hqNxFunction( reinterpret_cast<int*>(cImageIn.m_pBitmap), newBuffer, cImageIn.m_Xres, cImageIn.m_Yres, outWidth*4 );
+	ScaleSlices(N, reinterpret_cast<uint32_t*>(cImageIn.m_pBitmap), reinterpret_cast<uint32_t*>(newBuffer), inWidth, inHeight,
+		[=](uint32_t *src, uint32_t *dest, int rows) { hqNxFunction(reinterpret_cast<int*>(src), reinterpret_cast<unsigned char*>(dest), inWidth, rows, outWidth * 4); });
 	delete[] inputBuffer;
 	return newBuffer;
 }
@@ -296,7 +343,8 @@ static unsigned char *hqNxHelper( void (HQX_CALLCONV *hqNxFunction) ( unsigned*,
 	outHeight = N *inHeight;
 
 	unsigned char * newBuffer = new unsigned char[outWidth*outHeight*4];
-	hqNxFunction( reinterpret_cast<unsigned*>(inputBuffer), reinterpret_cast<unsigned*>(newBuffer), inWidth, inHeight );
+	ScaleSlices(N, reinterpret_cast<uint32_t*>(inputBuffer), reinterpret_cast<uint32_t*>(newBuffer), inWidth, inHeight,
+		[=](uint32_t *src, uint32_t *dest, int rows) { hqNxFunction(src, dest, inWidth, rows); });
 	delete[] inputBuffer;
 	return newBuffer;
 }
@@ -346,6 +394,208 @@ static void xbrzOldScale(size_t factor, const uint32_t* src, uint32_t* trg, int
 }
 
 
+//===========================================================================
+//
+// Upscale cache
+//
+// Stores the results of the scalers on disk so that they do not need to be
+// recomputed every session. The key is the hash of the source pixels
+// combined with the scaler settings, so any change to the source image,
+// its translation or the scaling method results in a different file.
+// The pixels are stored uncompressed so that the file can be mapped
+// directly into memory when it gets read back.
+// Files are written on a worker thread. Once the cache outgrows its budget
+// the least recently used files get deleted, which is tracked through the
+// files' modification time.
+//
+//===========================================================================
+
+static const char UpscaleCacheMagic[4] = { 'Z', 'D', 'U', 'C' };
+static const uint32_t UpscaleCacheVersion = 1;
+enum { MIN_UPSCALECACHE_PIXELS = 64 * 64 };
+
+// Limits how much memory the results waiting to be written may take up.
+// Anything beyond that does not get cached.
+static const size_t MAX_UPSCALECACHE_PENDING = 256 * 1024 * 1024;
+static std::atomic<size_t> UpscaleCachePending(0);
+
+// These are only accessed by the worker thread.
+static bool UpscaleCacheScanned;
+static size_t UpscaleCacheSize;
+
+static ctpl::thread_pool &UpscaleCachePool()
+{
+	static ctpl::thread_pool pool(1);
+	return pool;
+}
+
+static FString GetUpscaleCacheKey(const unsigned char *buffer, int inWidth, int inHeight, int type, int mult)
+{
+	int32_t params[4] = { inWidth, inHeight, type, mult };
+	uint8_t digest[16];
+	MD5Context md5;
+	md5.Update((const uint8_t *)params, sizeof(params));
+	md5.Update(buffer, inWidth * inHeight * 4);
+	md5.Final(digest);
+
+	FString key;
+	for (int i = 0; i < 16; i++) key.AppendFormat("%02x", digest[i]);
+	return key;
+}
+
+static FString GetUpscaleCacheDir(bool create)
+{
+	FString path = M_GetCachePath(create);
+	path << "/texcache";
+	if (create) CreatePath(path);
+	path << '/';
+	return path;
+}
+
+static FString GetUpscaleCacheName(const FString &key, bool create)
+{
+	FString path = GetUpscaleCacheDir(create);
+	path << key << ".zduc";
+	return path;
+}
+
+//===========================================================================
+//
+// Deletes the least recently used files until the cache is well below its
+// budget, so that this does not need to be done again for every new file.
+//
+//===========================================================================
+
+static void PruneUpscaleCache(size_t budget)
+{
+	struct FCacheFile
+	{
+		FString Name;
+		size_t Size;
+		time_t Time;
+	};
+
+	FString dir = GetUpscaleCacheDir(false);
+	TArray<FCacheFile> files;
+	size_t total = 0;
+
+	if (DirExists(dir))
+	{
+		TArray<FFileList> list;
+		ScanDirectory(list, dir);
+		for (auto &entry : list)
+		{
+			FCacheFile file;
+			if (!entry.isDirectory && entry.Filename.Right(5).CompareNoCase(".zduc") == 0 && GetFileInfo(entry.Filename, &file.Size, &file.Time))
+			{
+				file.Name = entry.Filename;
+				total += file.Size;
+				files.Push(file);
+			}
+		}
+	}
+
+	if (total > budget)
+	{
+		std::sort(files.begin(), files.end(), [](const FCacheFile &a, const FCacheFile &b) { return a.Time < b.Time; });
+		for (auto &file : files)
+		{
+			if (total <= budget / 4 * 3) break;
+			if (remove(file.Name) == 0) total -= file.Size;
+		}
+	}
+	UpscaleCacheSize = total;
+	UpscaleCacheScanned = true;
+}
+
+static unsigned char *LoadUpscaleCache(const FString &key, int outWidth, int outHeight)
+{
+	FileReader fr;
+	if (!fr.OpenFileMapped(GetUpscaleCacheName(key, false)))
+		return nullptr;
+
+	const size_t datasize = (size_t)outWidth * outHeight * 4;
+	if ((size_t)fr.GetLength() != 16 + datasize)
+		return nullptr;
+
+	char magic[4];
+	uint32_t header[3];
+	if (fr.Read(magic, 4) != 4 || memcmp(magic, UpscaleCacheMagic, 4) || fr.Read(header, sizeof(header)) != sizeof(header) ||
+		header[0] != UpscaleCacheVersion || header[1] != (uint32_t)outWidth || header[2] != (uint32_t)outHeight)
+		return nullptr;
+
+	unsigned char *newBuffer = new unsigned char[datasize];
+	auto mapped = fr.GetBuffer();
+	if (mapped != nullptr)
+	{
+		memcpy(newBuffer, mapped + 16, datasize);
+	}
+	else if ((size_t)fr.Read(newBuffer, datasize) != datasize)
+	{
+		delete[] newBuffer;
+		return nullptr;
+	}
+
+	// Mark the file as recently used.
+	FString name = GetUpscaleCacheName(key, false);
+	UpscaleCachePool().push([name](int) { TouchFile(name); });
+	return newBuffer;
+}
+
+static void WriteUpscaleCache(const FString &key, const TArray<unsigned char> &pixels, int outWidth, int outHeight)
+{
+	const size_t budget = (size_t)MAX(0, *gl_texture_hqresize_diskcachesize) * 1024 * 1024;
+	if (!UpscaleCacheScanned)
+	{
+		PruneUpscaleCache(budget);
+	}
+
+	// Write to a temporary file first so that an incomplete file never gets read.
+	FString name = GetUpscaleCacheName(key, true);
+	FString tempname = name + ".tmp";
+	std::unique_ptr<FileWriter> fw(FileWriter::Open(tempname));
+	if (fw)
+	{
+		uint32_t header[3] = { UpscaleCacheVersion, (uint32_t)outWidth, (uint32_t)outHeight };
+		bool ok = fw->Write(UpscaleCacheMagic, 4) == 4 && fw->Write(header, sizeof(header)) == sizeof(header) &&
+			fw->Write(pixels.Data(), pixels.Size()) == pixels.Size();
+		fw.reset();
+		if (ok && myrename(tempname, name))
+		{
+			UpscaleCacheSize += 16 + pixels.Size();
+		}
+		else
+		{
+			remove(tempname);
+		}
+	}
+
+	if (UpscaleCacheSize > budget)
+	{
+		PruneUpscaleCache(budget);
+	}
+}
+
+static void SaveUpscaleCache(const FString &key, const unsigned char *buffer, int outWidth, int outHeight)
+{
+	const size_t datasize = (size_t)outWidth * outHeight * 4;
+	if (UpscaleCachePending.fetch_add(datasize) + datasize > MAX_UPSCALECACHE_PENDING)
+	{
+		UpscaleCachePending -= datasize;
+		return;
+	}
+
+	// The buffer gets uploaded and freed right away so the worker needs its own copy.
+	auto pixels = std::make_shared<TArray<unsigned char>>(datasize, true);
+	memcpy(pixels->Data(), buffer, datasize);
+	UpscaleCachePool().push([=](int)
+	{
+		WriteUpscaleCache(key, *pixels, outWidth, outHeight);
+		UpscaleCachePending -= datasize;
+	});
+}
+
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in texbuffer.mBuffer, frees texbuffer.mBuffer and returns
@@ -402,7 +652,23 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 
 	if (!checkonly)
 	{
-		if (type == 1)
+		FString cachekey;
+		unsigned char *cached = nullptr;
+		if (gl_texture_hqresize_diskcache && inWidth * inHeight >= MIN_UPSCALECACHE_PIXELS)
+		{
+			cachekey = GetUpscaleCacheKey(texbuffer.mBuffer, inWidth, inHeight, type, mult);
+			cached = LoadUpscaleCache(cachekey, inWidth * mult, inHeight * mult);
+		}
+
+		if (cached != nullptr)
+		{
+			delete[] texbuffer.mBuffer;
+			texbuffer.mBuffer = cached;
+			texbuffer.mWidth = inWidth * mult;
+			texbuffer.mHeight = inHeight * mult;
+			cachekey = "";
+		}
+		else if (type == 1)
 		{
 			if (mult == 2)
 				texbuffer.mBuffer = scaleNxHelper(&scale2x, 2, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
@@ -442,6 +708,11 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 			texbuffer.mBuffer = normalNxHelper(&normalNx, mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
 		else
 			return;
+
+		if (cachekey.IsNotEmpty())
+		{
+			SaveUpscaleCache(cachekey, texbuffer.mBuffer, texbuffer.mWidth, texbuffer.mHeight);
+		}
 	}
 	else
 	{
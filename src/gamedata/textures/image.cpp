@@ -368,6 +368,15 @@ FImageSource * FImageSource::GetImage(int lumpnum, ETextureType usetype)
 	// An image for this lump already exists. We do not need another one.
 	if (ImageForLump[lumpnum] != nullptr) return ImageForLump[lumpnum];
 
+	// Another lump with the same data may already have one, too.
+	int contentlump = Wads.GetContentLump(lumpnum);
+	if (contentlump != lumpnum && Wads.GetLumpNamespace(contentlump) == Wads.GetLumpNamespace(lumpnum))
+	{
+		auto image = GetImage(contentlump, usetype);
+		ImageForLump[lumpnum] = image;
+		return image;
+	}
+
 	auto data = Wads.OpenLumpReader(lumpnum);
 
 	for (size_t i = 0; i < countof(CreateInfo); i++)
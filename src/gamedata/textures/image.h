@@ -146,7 +146,7 @@ class FImageTexture : public FTexture
 {
 	FImageSource *mImage;
 public:
-	FImageTexture (FImageSource *image, const char *name = nullptr);
+	FImageTexture (FImageSource *image, const char *name = nullptr, int lumpnum = -1);
 	virtual TArray<uint8_t> Get8BitPixels(bool alphatex);
 
 	void SetImage(FImageSource *img)	// This is only for the multipatch texture builder!
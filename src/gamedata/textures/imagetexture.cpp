@@ -48,13 +48,13 @@
 //
 //==========================================================================
 
-FImageTexture::FImageTexture(FImageSource *img, const char *name)
-: FTexture(name, img? img->LumpNum() : 0)
+FImageTexture::FImageTexture(FImageSource *img, const char *name, int lumpnum)
+: FTexture(name, lumpnum >= 0? lumpnum : img? img->LumpNum() : 0)
 {
 	mImage = img;
 	if (img != nullptr)
 	{
-		if (name == nullptr) Wads.GetLumpName(Name, img->LumpNum());
+		if (name == nullptr) Wads.GetLumpName(Name, SourceLump);
 		Width = img->GetWidth();
 		Height = img->GetHeight();
 
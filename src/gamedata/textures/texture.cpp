@@ -97,7 +97,8 @@ FTexture * FTexture::CreateTexture(const char *name, int lumpnum, ETextureType u
 	auto image = FImageSource::GetImage(lumpnum, usetype);
 	if (image != nullptr)
 	{
-		FTexture *tex = new FImageTexture(image);
+		// The image may be shared with another lump that has the same content.
+		FTexture *tex = new FImageTexture(image, nullptr, lumpnum);
 		if (tex != nullptr) 
 		{
 			tex->UseType = usetype;
@@ -589,6 +589,7 @@ void FTextureManager::AddGroup(int wadnum, int ns, ETextureType usetype)
 	int firsttx = Wads.GetFirstLump(wadnum);
 	int lasttx = Wads.GetLastLump(wadnum);
 	FString Name;
+	TArray<int> lumps;	// -1 for entries that only advance the progress bar
 
 	// Go from first to last so that ANIMDEFS work as expected. However,
 	// to avoid duplicates (and to keep earlier entries from overriding
@@ -600,22 +601,24 @@ void FTextureManager::AddGroup(int wadnum, int ns, ETextureType usetype)
 		if (Wads.GetLumpNamespace(firsttx) == ns)
 		{
 			Wads.GetLumpName (Name, firsttx);
-
-			if (Wads.CheckNumForName (Name, ns) == firsttx)
-			{
-				CreateTexture (firsttx, usetype);
-			}
-			StartScreen->Progress();
+			lumps.Push(Wads.CheckNumForName (Name, ns) == firsttx ? firsttx : -1);
 		}
 		else if (ns == ns_flats && Wads.GetLumpFlags(firsttx) & LUMPF_MAYBEFLAT)
 		{
-			if (Wads.CheckNumForName (Name, ns) < firsttx)
-			{
-				CreateTexture (firsttx, usetype);
-			}
-			StartScreen->Progress();
+			lumps.Push(Wads.CheckNumForName (Name, ns) < firsttx ? firsttx : -1);
 		}
 	}
+
+	FLumpPrefetchWindow prefetch(lumps);
+	for (unsigned i = 0; i < lumps.Size(); i++)
+	{
+		prefetch.Advance(i);
+		if (lumps[i] >= 0)
+		{
+			CreateTexture (lumps[i], usetype);
+		}
+		StartScreen->Progress();
+	}
 }
 
 //==========================================================================
@@ -951,6 +954,8 @@ void FTextureManager::AddTexturesForWad(int wadnum, FMultipatchTextureBuilder &b
 	// Sixth step: Try to find any lump in the WAD that may be a texture and load as a TEX_MiscPatch
 	int firsttx = Wads.GetFirstLump(wadnum);
 	int lasttx = Wads.GetLastLump(wadnum);
+	TArray<int> candidates;
+	TArray<bool> skins;
 
 	for (int i= firsttx; i <= lasttx; i++)
 	{
@@ -1017,9 +1022,20 @@ void FTextureManager::AddTexturesForWad(int wadnum, FMultipatchTextureBuilder &b
 		}
 		else continue;
 
+		candidates.Push(i);
+		skins.Push(skin);
+	}
+
+	FLumpPrefetchWindow prefetch(candidates);
+	for (unsigned i = 0; i < candidates.Size(); i++)
+	{
+		FString Name;
+		Wads.GetLumpName(Name, candidates[i]);
+		prefetch.Advance(i);
+
 		// Try to create a texture from this lump and add it.
 		// Unfortunately we have to look at everything that comes through here...
-		FTexture *out = FTexture::CreateTexture(Name, i, skin ? ETextureType::SkinGraphic : ETextureType::MiscPatch);
+		FTexture *out = FTexture::CreateTexture(Name, candidates[i], skins[i] ? ETextureType::SkinGraphic : ETextureType::MiscPatch);
 
 		if (out != NULL) 
 		{
@@ -1034,6 +1050,9 @@ void FTextureManager::AddTexturesForWad(int wadnum, FMultipatchTextureBuilder &b
 	// Seventh step: Check for hires replacements.
 	AddHiresTextures(wadnum);
 
+	// Lumps that turned out not to be needed may still have data waiting.
+	Wads.DiscardPrefetchedLumps();
+
 	SortTexturesByType(firsttexture, Textures.Size());
 }
 
@@ -49,7 +49,10 @@
 #include "v_text.h"
 #include "gi.h"
 #include "resourcefiles/resourcefile.h"
+#include "resourcefiles/file_zip.h"
 #include "md5.h"
+#include "i_time.h"
+#include "templates.h"
 #include "doomstat.h"
 #include "vm.h"
 
@@ -63,6 +66,7 @@
 struct FWadCollection::LumpRecord
 {
 	int			wadnum;
+	int			contentlump;	// first lump with the same data, set up by FindDuplicateLumps
 	FResourceLump *lump;
 };
 
@@ -166,10 +170,176 @@ void FWadCollection::InitMultipleFiles (TArray<FString> &filenames, const TArray
 	FirstLumpIndex_NoExt = &Hashes[NumLumps*4];
 	NextLumpIndex_NoExt = &Hashes[NumLumps*5];
 	InitHashChains ();
+	FindDuplicateLumps ();
 	LumpInfo.ShrinkToFit();
 	Files.ShrinkToFit();
 }
 
+//==========================================================================
+//
+// FindDuplicateLumps
+//
+// Mods tend to ship the same sprites, sounds and textures over and over
+// again. Lumps with identical content get linked to the first one so that
+// the data only gets loaded, decompressed and kept in memory once.
+//
+// Only lumps whose size appears more than once are looked at. Zip entries
+// come with a CRC, for everything else it gets calculated, and any lumps
+// matching on both get verified by comparing their MD5 digests.
+//
+// Lumps of memory mapped files are left alone. Their cache points straight
+// into the mapping, so there is nothing to share.
+// Compressed lumps only get decompressed for the check if they match an
+// uncompressed lump. Among themselves their raw data gets compared, which
+// only misses duplicates that were compressed differently.
+//
+//==========================================================================
+
+static bool IsLumpMapped(FResourceLump *rl)
+{
+	if (rl->Flags & (LUMPF_COMPRESSED | LUMPF_BLOODCRYPT)) return false;
+	auto reader = rl->Owner != nullptr ? rl->Owner->GetReader() : nullptr;
+	return reader != nullptr && reader->GetBuffer() != nullptr;
+}
+
+void FWadCollection::FindDuplicateLumps ()
+{
+	struct DupeCandidate
+	{
+		int size;
+		uint32_t crc;
+		unsigned lump;
+	};
+
+	DuplicateLumps = 0;
+	DuplicateBytes = 0;
+	if (Args->CheckParm("-nolumpdedup")) return;
+
+	uint64_t starttime = I_nsTime();
+	size_t hashedbytes = 0;
+
+	TMap<int, int> sizecount;
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		auto rl = LumpInfo[i].lump;
+		if (rl->LumpSize <= 0 || IsLumpMapped(rl)) continue;
+		int *count = sizecount.CheckKey(rl->LumpSize);
+		if (count != nullptr) (*count)++;
+		else sizecount.Insert(rl->LumpSize, 1);
+	}
+
+	TArray<DupeCandidate> candidates;
+	TArray<uint8_t> buffer(65536, true);
+	for (uint32_t i = 0; i < NumLumps; i++)
+	{
+		auto rl = LumpInfo[i].lump;
+		if (rl->LumpSize <= 0) continue;
+		int *count = sizecount.CheckKey(rl->LumpSize);
+		if (count == nullptr || *count < 2 || IsLumpMapped(rl)) continue;
+
+		uint32_t crc;
+		if (!rl->GetCRC32(crc))
+		{
+			// Without a stored CRC a compressed lump would have to be unpacked to find out. Not worth it.
+			if (rl->Flags & LUMPF_COMPRESSED) continue;
+
+			auto reader = OpenLumpReader(i);
+			crc = 0;
+			for (long remaining = rl->LumpSize; remaining > 0; )
+			{
+				long numread = reader.Read(buffer.Data(), MIN<long>(remaining, buffer.Size()));
+				if (numread <= 0) break;
+				crc = AddCRC32(crc, buffer.Data(), numread);
+				remaining -= numread;
+			}
+			hashedbytes += rl->LumpSize;
+		}
+		candidates.Push({ rl->LumpSize, crc, i });
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [](const DupeCandidate &a, const DupeCandidate &b)
+	{
+		if (a.size != b.size) return a.size < b.size;
+		if (a.crc != b.crc) return a.crc < b.crc;
+		return a.lump < b.lump;
+	});
+
+	TArray<std::pair<unsigned, FString>> digests;
+	for (unsigned start = 0, end; start < candidates.Size(); start = end)
+	{
+		for (end = start + 1; end < candidates.Size() && candidates[end].size == candidates[start].size && candidates[end].crc == candidates[start].crc; end++);
+		if (end - start < 2) continue;
+
+		// Only candidates with a stored CRC can be compressed, i.e. these are all zip entries,
+		// whose raw data can be read without decompressing it.
+		bool hasplain = false;
+		for (unsigned j = start; j < end; j++)
+		{
+			if (!(LumpInfo[candidates[j].lump].lump->Flags & LUMPF_COMPRESSED)) hasplain = true;
+		}
+
+		digests.Clear();
+		for (unsigned j = start; j < end; j++)
+		{
+			unsigned lump = candidates[j].lump;
+			auto rl = LumpInfo[lump].lump;
+			uint8_t digest[16];
+			MD5Context md5;
+			FString key;
+			if ((rl->Flags & LUMPF_COMPRESSED) && !hasplain)
+			{
+				FCompressedBuffer raw = rl->GetRawData();
+				md5.Update((const uint8_t*)raw.mBuffer, raw.mCompressedSize);
+				key.Format("%d:", raw.mMethod);
+				hashedbytes += raw.mCompressedSize;
+				raw.Clean();
+			}
+			else
+			{
+				auto reader = OpenLumpReader(lump);
+				md5.Update(reader, candidates[j].size);
+				hashedbytes += candidates[j].size;
+			}
+			md5.Final(digest);
+			key.AppendCStrPart((const char*)digest, 16);
+			digests.Push(std::make_pair(lump, key));
+		}
+
+		for (unsigned j = 0; j < digests.Size(); j++)
+		{
+			if (LumpInfo[digests[j].first].contentlump != (int)digests[j].first) continue;	// already linked to an earlier one.
+
+			// Prefer a lump that doesn't need decompressing as the one holding the data.
+			for (unsigned k = j + 1; k < digests.Size(); k++)
+			{
+				if (digests[k].second == digests[j].second && (LumpInfo[digests[j].first].lump->Flags & LUMPF_COMPRESSED) && !(LumpInfo[digests[k].first].lump->Flags & LUMPF_COMPRESSED))
+				{
+					std::swap(digests[j], digests[k]);
+					break;
+				}
+			}
+			// Always link to the end of an existing chain so that no alias ever points to another alias.
+			int canonlump = GetContentLump(digests[j].first);
+
+			for (unsigned k = j + 1; k < digests.Size(); k++)
+			{
+				auto &dupe = LumpInfo[digests[k].first];
+				if (digests[k].second != digests[j].second || dupe.contentlump != (int)digests[k].first) continue;
+				// Lumps that are already in use by an open reader must keep their own cache.
+				dupe.lump->FreeUnusedCache();
+				if (dupe.lump->Cache != nullptr) continue;
+
+				dupe.lump->ContentAlias = LumpInfo[canonlump].lump;
+				dupe.contentlump = canonlump;
+				DuplicateLumps++;
+				DuplicateBytes += dupe.lump->LumpSize;
+			}
+		}
+	}
+	DPrintf(DMSG_NOTIFY, "Lump deduplication: %u duplicate lumps found in %u candidates, %zu bytes read, %.1f ms\n",
+		DuplicateLumps, candidates.Size(), hashedbytes, (I_nsTime() - starttime) / 1e6);
+}
+
 //-----------------------------------------------------------------------
 //
 // Adds an external file to the lump list but not to the hash chains
@@ -185,6 +355,7 @@ int FWadCollection::AddExternalFile(const char *filename)
 	FWadCollection::LumpRecord *lumprec = &LumpInfo[LumpInfo.Reserve(1)];
 	lumprec->lump = lump;
 	lumprec->wadnum = -1;
+	lumprec->contentlump = LumpInfo.Size()-1;
 	return LumpInfo.Size()-1;	// later
 }
 
@@ -216,7 +387,9 @@ void FWadCollection::AddFile (const char *filename, FileReader *wadr)
 
 		if (!isdir)
 		{
-			if (!wadreader.OpenFile(filename))
+			// Mapping the file allows uncompressed lumps to be used without copying them into a separate cache.
+			static const bool nomap = !!Args->CheckParm("-nomapfiles");
+			if (!(nomap ? wadreader.OpenFile(filename) : wadreader.OpenFileMapped(filename)))
 			{ // Didn't find file
 				Printf (TEXTCOLOR_RED "%s: File not found\n", filename);
 				PrintLastError ();
@@ -248,6 +421,7 @@ void FWadCollection::AddFile (const char *filename, FileReader *wadr)
 
 			lump_p->lump = lump;
 			lump_p->wadnum = Files.Size();
+			lump_p->contentlump = LumpInfo.Size()-1;
 		}
 
 		if (static_cast<int>(Files.Size()) == GetIwadNum() && gameinfo.gametype == GAME_Strife && gameinfo.flags & GI_SHAREWARE)
@@ -1249,6 +1423,24 @@ int FWadCollection::GetLumpIndexNum(int lump) const
 		return LumpInfo[lump].lump->GetIndexNum();
 }
 
+//==========================================================================
+//
+// FWadCollection :: GetContentLump
+//
+// Returns the lump whose data this lump shares, so that anything derived
+// from the data only needs to be created once.
+//
+//==========================================================================
+
+int FWadCollection::GetContentLump(int lump) const
+{
+	if ((size_t)lump >= NumLumps)
+		return lump;
+	// Follow the chain in case the lump got linked to one that is an alias itself.
+	while (LumpInfo[lump].contentlump != lump) lump = LumpInfo[lump].contentlump;
+	return lump;
+}
+
 //==========================================================================
 //
 // W_GetLumpFile
@@ -1398,6 +1590,33 @@ DEFINE_ACTION_FUNCTION(_Wads, ReadLump)
 	ACTION_RETURN_STRING(isLumpValid ? Wads.ReadLump(lump).GetString() : FString());
 }
 
+//==========================================================================
+//
+// PrefetchLumps
+//
+// Queues all compressed lumps in the list for decompression on worker
+// threads. Reading any of them later will use the result.
+//
+//==========================================================================
+
+void FWadCollection::PrefetchLumps(const TArray<int> &lumps)
+{
+	for (int lump : lumps)
+	{
+		if ((unsigned)lump < (unsigned)LumpInfo.Size())
+		{
+			auto rl = LumpInfo[lump].lump;
+			if (rl->ContentAlias != nullptr) rl = rl->ContentAlias;
+			if (rl->Flags & LUMPF_COMPRESSED) rl->Prefetch();
+		}
+	}
+}
+
+void FWadCollection::DiscardPrefetchedLumps()
+{
+	FZipLump::DiscardPrefetched();
+}
+
 //==========================================================================
 //
 // OpenLumpReader
@@ -1417,7 +1636,7 @@ FileReader FWadCollection::OpenLumpReader(int lump)
 	auto rl = LumpInfo[lump].lump;
 	auto rd = rl->GetReader();
 
-	if (rl->RefCount == 0 && rd != nullptr && !rd->GetBuffer() && !(rl->Flags & (LUMPF_BLOODCRYPT | LUMPF_COMPRESSED)))
+	if (rl->RefCount == 0 && rl->Cache == nullptr && rd != nullptr && !rd->GetBuffer() && !(rl->Flags & (LUMPF_BLOODCRYPT | LUMPF_COMPRESSED)))
 	{
 		FileReader rdr;
 		rdr.OpenFilePart(*rd, rl->GetFileOffset(), rl->LumpSize);
@@ -1691,3 +1910,18 @@ CCMD(lumpnumfull)
 	}
 }
 #endif
+
+//==========================================================================
+//
+// CCMD LumpDupes
+//
+// Reports how much data is shared between lumps with identical content.
+//
+//==========================================================================
+
+CCMD(lumpdupes)
+{
+	size_t bytes;
+	unsigned count = Wads.GetDuplicateLumps(bytes);
+	Printf("%u of %d lumps are duplicates, %zu bytes saved (%.2f MB)\n", count, Wads.GetNumLumps(), bytes, bytes / (1024. * 1024.));
+}
@@ -158,6 +158,9 @@ public:
 	FMemLump ReadLump (int lump);
 	FMemLump ReadLump (const char *name) { return ReadLump (GetNumForName (name)); }
 
+	void PrefetchLumps(const TArray<int> &lumps);	// starts decompressing these lumps in the background so that reading them later is faster.
+	void DiscardPrefetchedLumps();				// frees prefetched data that never got read.
+
 	FileReader OpenLumpReader(int lump);		// opens a reader that redirects to the containing file's one.
 	FileReader ReopenLumpReader(int lump, bool alwayscache = false);		// opens an independent reader.
 
@@ -177,6 +180,7 @@ public:
 	int GetLumpFile (int lump) const;				// [RH] Returns wadnum for a specified lump
 	int GetLumpNamespace (int lump) const;			// [RH] Returns the namespace a lump belongs to
 	int GetLumpIndexNum (int lump) const;			// Returns the RFF index number for this lump
+	int GetContentLump (int lump) const;			// Returns the first lump with identical data, which may be the lump itself
 	FResourceLump *GetLumpRecord(int lump) const;	// Returns the FResourceLump, in case the caller wants to have direct access to the lump cache.
 	bool CheckLumpName (int lump, const char *name) const;	// [RH] Returns true if the names match
 	unsigned GetLumpsInFolder(const char *path, TArray<FolderEntry> &result, bool atomic) const;
@@ -188,6 +192,8 @@ public:
 
 	int AddExternalFile(const char *filename);
 
+	unsigned GetDuplicateLumps(size_t &bytes) const { bytes = DuplicateBytes; return DuplicateLumps; }
+
 protected:
 
 	struct LumpRecord;
@@ -210,7 +216,11 @@ protected:
 
 	int IwadIndex;
 
+	unsigned DuplicateLumps = 0;			// statistics for the content deduplication
+	size_t DuplicateBytes = 0;
+
 	void InitHashChains ();								// [RH] Set up the lumpinfo hashing
+	void FindDuplicateLumps ();							// Lets lumps with identical data share one cache
 
 private:
 	void RenameSprites(const TArray<FString> &deletelumps);
@@ -222,4 +232,38 @@ private:
 
 extern FWadCollection Wads;
 
+//==========================================================================
+//
+// FLumpPrefetchWindow
+//
+// Lets the lumps of a list get decompressed on worker threads while the
+// main thread processes them in order. It only stays a limited distance
+// ahead so that a big texture pack is not unpacked into memory all at
+// once.
+//
+//==========================================================================
+
+class FLumpPrefetchWindow
+{
+	enum { WINDOW = 256 };
+
+	const TArray<int> &Lumps;
+	unsigned Queued = 0;
+	TArray<int> Batch;
+
+public:
+	FLumpPrefetchWindow(const TArray<int> &lumps) : Lumps(lumps) {}
+
+	// pos is the index of the list entry that is about to be processed.
+	void Advance(unsigned pos)
+	{
+		if (Queued > pos + WINDOW / 2 || Queued >= Lumps.Size()) return;
+
+		unsigned end = pos + WINDOW < Lumps.Size() ? pos + WINDOW : Lumps.Size();
+		Batch.Clear();
+		for (; Queued < end; Queued++) Batch.Push(Lumps[Queued]);
+		Wads.PrefetchLumps(Batch);
+	}
+};
+
 #endif
@@ -928,6 +928,7 @@ bool MapLoader::CheckNodes(MapData * map, bool rebuilt, int buildtime)
 		{
 			DPrintf(DMSG_NOTIFY, "Caching nodes\n");
 			CreateCachedNodes(map);
+			UseLevelCache = true;
 		}
 		else
 		{
@@ -946,7 +947,7 @@ bool MapLoader::CheckNodes(MapData * map, bool rebuilt, int buildtime)
 typedef TArray<uint8_t> MemFile;
 
 
-static FString CreateCacheName(MapData *map, bool create)
+static FString CreateCacheName(MapData *map, bool create, const char *ext = ".gzc")
 {
 	FString path = M_GetCachePath(create);
 	FString lumpname = Wads.GetLumpFullPath(map->lumpnum);
@@ -956,7 +957,7 @@ static FString CreateCacheName(MapData *map, bool create)
 
 	lumpname.ReplaceChars('/', '%');
 	lumpname.ReplaceChars(':', '$');
-	path << '/' << lumpname.Right(lumpname.Len() - separator - 1) << ".gzc";
+	path << '/' << lumpname.Right(lumpname.Len() - separator - 1) << ext;
 	return path;
 }
 
@@ -1072,6 +1073,9 @@ void MapLoader::CreateCachedNodes(MapData *map)
 	}
 	memcpy(&compressed[offset - 4], "ZGL3", 4);
 
+	// The level data that was cached for the old nodes does not fit the new ones.
+	remove(CreateCacheName(map, false, ".gzl"));
+
 	FString path = CreateCacheName(map, true);
 	FileWriter *fw = FileWriter::Open(path);
 
@@ -1142,6 +1146,409 @@ bool MapLoader::CheckCachedNodes(MapData *map)
 		line.v1 = &Level->vertexes[LittleLong(verts[i*2])];
 		line.v2 = &Level->vertexes[LittleLong(verts[i*2+1])];
 	}
+	UseLevelCache = true;
+	return true;
+}
+
+//==========================================================================
+//
+// Level data caching
+//
+// Maps whose nodes are worth caching usually are big enough that the other
+// data derived from the map's geometry takes noticeable time to create as
+// well. The generated blockmap and the render sections get stored in one
+// file next to the nodes, using the same key, and all of it is read back
+// in one go once the nodes are known to come from the cache.
+//
+// The file consists of a header and a compressed payload of chunks, each
+// starting with a 4 character id and its size. A chunk that is missing or
+// does not fit the level just gets created the regular way.
+//
+//==========================================================================
+
+enum
+{
+	LEVELCACHE_VERSION = 1,
+	LEVELCACHE_HEADER = 4 + 16 + 8 * 4,	// id, checksum, the level cache key and the payload size
+};
+
+static void WriteChunkHeader(MemFile &f, const char *id, unsigned &sizepos)
+{
+	for (int i = 0; i < 4; i++) WriteByte(f, id[i]);
+	sizepos = f.Size();
+	WriteLong(f, 0);
+}
+
+static void EndChunk(MemFile &f, unsigned sizepos)
+{
+	uint32_t size = LittleLong(uint32_t(f.Size() - sizepos - 4));
+	memcpy(&f[sizepos], &size, 4);
+}
+
+// Reads the chunks of the level cache. Every read is bounds checked and
+// an invalid read only sets the error flag, so that a damaged file cannot
+// do any harm.
+struct FLevelCacheReader
+{
+	const uint8_t *data;
+	uint32_t size;
+	uint32_t pos = 0;
+	bool error = false;
+
+	uint32_t ReadLong()
+	{
+		if (pos > size || size - pos < 4)
+		{
+			error = true;
+			return 0;
+		}
+		uint32_t v = data[pos] | (data[pos + 1] << 8) | (data[pos + 2] << 16) | (uint32_t(data[pos + 3]) << 24);
+		pos += 4;
+		return v;
+	}
+
+	// Returns an index that must be below max, or UINT_MAX for a null reference.
+	uint32_t ReadIndex(uint32_t max, bool allownull = false)
+	{
+		uint32_t v = ReadLong();
+		if (allownull && v == 0xffffffffu) return UINT_MAX;
+		if (v >= max) error = true;
+		return error ? 0 : v;
+	}
+
+	double ReadDouble()
+	{
+		uint64_t v = ReadLong();
+		v |= uint64_t(ReadLong()) << 32;
+		double d;
+		memcpy(&d, &v, 8);
+		return d;
+	}
+};
+
+static void WriteDouble(MemFile &f, double d)
+{
+	uint64_t v;
+	memcpy(&v, &d, 8);
+	WriteLong(f, uint32_t(v));
+	WriteLong(f, uint32_t(v >> 32));
+}
+
+//==========================================================================
+//
+// Writes the level cache. count is the size of the blockmap, which is
+// only stored if it got generated.
+//
+//==========================================================================
+
+void MapLoader::CreateLevelCache(MapData *map, int count)
+{
+	MemFile payload;
+	unsigned sizepos;
+
+	if (count > 0)
+	{
+		WriteChunkHeader(payload, "BMAP", sizepos);
+		WriteLong(payload, count);
+		for (int i = 0; i < count; i++)
+		{
+			WriteLong(payload, Level->blockmap.blockmaplump[i]);
+		}
+		EndChunk(payload, sizepos);
+	}
+
+	auto &sections = Level->sections;
+	WriteChunkHeader(payload, "SECT", sizepos);
+	WriteLong(payload, sections.allSections.Size());
+	WriteLong(payload, sections.allLines.Size());
+	WriteLong(payload, sections.allSides.Size());
+	WriteLong(payload, sections.allSubsectors.Size());
+	for (auto &section : sections.allSections)
+	{
+		WriteLong(payload, section.sector->Index());
+		WriteLong(payload, section.mapsection);
+		WriteLong(payload, section.segments.Size());
+		WriteLong(payload, section.sides.Size());
+		WriteLong(payload, section.subsectors.Size());
+		WriteDouble(payload, section.bounds.left);
+		WriteDouble(payload, section.bounds.top);
+		WriteDouble(payload, section.bounds.right);
+		WriteDouble(payload, section.bounds.bottom);
+	}
+	for (auto &line : sections.allLines)
+	{
+		WriteLong(payload, Index(line.start));
+		WriteLong(payload, Index(line.end));
+		WriteLong(payload, line.partner == nullptr ? 0xffffffffu : uint32_t(line.partner - sections.allLines.Data()));
+		WriteLong(payload, sections.SectionIndex(line.section));
+		WriteLong(payload, line.sidedef == nullptr ? 0xffffffffu : uint32_t(line.sidedef->Index()));
+	}
+	for (auto side : sections.allSides)
+	{
+		WriteLong(payload, side->Index());
+	}
+	for (auto sub : sections.allSubsectors)
+	{
+		WriteLong(payload, Index(sub));
+	}
+	for (unsigned i = 0; i < Level->sectors.Size(); i++)
+	{
+		WriteLong(payload, sections.firstSectionForSectorPtr[i]);
+		WriteLong(payload, sections.numberOfSectionForSectorPtr[i]);
+	}
+	for (auto &sub : Level->subsectors)
+	{
+		WriteLong(payload, sections.SectionIndex(sub.section));
+	}
+	EndChunk(payload, sizepos);
+
+	uLongf outlen = compressBound(payload.Size());
+	TArray<Bytef> compressed;
+
+	compressed.Resize(outlen + LEVELCACHE_HEADER);
+	if (compress(compressed.Data() + LEVELCACHE_HEADER, &outlen, payload.Data(), payload.Size()) != Z_OK)
+	{
+		return;
+	}
+
+	memcpy(compressed.Data(), "CACL", 4);
+	for (unsigned i = 0; i <= countof(LevelCacheKey); i++)
+	{
+		uint32_t v = LittleLong(i < countof(LevelCacheKey) ? LevelCacheKey[i] : payload.Size());
+		memcpy(&compressed[4 + 16 + i * 4], &v, 4);
+	}
+	map->GetChecksum(&compressed[4]);
+
+	// Write to a temporary file first so that a crash cannot leave a truncated cache behind.
+	FString path = CreateCacheName(map, true, ".gzl");
+	FString tempname = path + ".tmp";
+	FileWriter *fw = FileWriter::Open(tempname);
+
+	if (fw != nullptr)
+	{
+		const size_t length = outlen + LEVELCACHE_HEADER;
+		bool ok = fw->Write(compressed.Data(), length) == length;
+		delete fw;
+		if (!ok || !myrename(tempname, path))
+		{
+			Printf("Error saving level data to file %s\n", path.GetChars());
+			remove(tempname);
+		}
+	}
+	else
+	{
+		Printf("Cannot open level data file %s for writing\n", path.GetChars());
+	}
+}
+
+//==========================================================================
+//
+// Reads the entire level cache into memory, if it matches the level.
+//
+//==========================================================================
+
+void MapLoader::ReadLevelCache(MapData *map)
+{
+	LevelCache.Clear();
+
+	// Besides the map itself the data also depends on the nodes, so their size is part of the key.
+	// This must be taken before FixHoles adds to the segs and subsectors.
+	const uint32_t key[] = { LEVELCACHE_VERSION, Level->lines.Size(), Level->sides.Size(), Level->sectors.Size(),
+		Level->vertexes.Size(), Level->subsectors.Size(), Level->segs.Size() };
+	static_assert(sizeof(key) == sizeof(LevelCacheKey), "level cache key size mismatch");
+	memcpy(LevelCacheKey, key, sizeof(key));
+
+	FString path = CreateCacheName(map, false, ".gzl");
+	FileReader fr;
+
+	if (!fr.OpenFile(path)) return;
+	auto data = fr.Read(fr.GetLength());
+	if (data.Size() <= LEVELCACHE_HEADER || memcmp(data.Data(), "CACL", 4)) return;
+
+	uint8_t md5map[16];
+	map->GetChecksum(md5map);
+	if (memcmp(&data[4], md5map, 16)) return;
+
+	uint32_t header[countof(LevelCacheKey) + 1];
+	for (unsigned i = 0; i < countof(header); i++)
+	{
+		memcpy(&header[i], &data[4 + 16 + i * 4], 4);
+		header[i] = LittleLong(header[i]);
+	}
+	if (memcmp(header, LevelCacheKey, sizeof(LevelCacheKey))) return;
+
+	uint32_t size = header[countof(LevelCacheKey)];
+	if (size > 0x40000000) return;
+	LevelCache.Resize(size);
+	uLongf outlen = size;
+	if (uncompress(LevelCache.Data(), &outlen, data.Data() + LEVELCACHE_HEADER, data.Size() - LEVELCACHE_HEADER) != Z_OK || outlen != size)
+	{
+		LevelCache.Clear();
+	}
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+bool MapLoader::FindLevelCacheChunk(const char *id, const uint8_t *&chunk, uint32_t &size)
+{
+	FLevelCacheReader fr = { LevelCache.Data(), LevelCache.Size() };
+	while (fr.pos + 8 <= fr.size)
+	{
+		const uint8_t *chunkid = fr.data + fr.pos;
+		fr.pos += 4;
+		uint32_t chunksize = fr.ReadLong();
+		if (chunksize > fr.size - fr.pos) return false;
+		if (!memcmp(chunkid, id, 4))
+		{
+			chunk = fr.data + fr.pos;
+			size = chunksize;
+			return true;
+		}
+		fr.pos += chunksize;
+	}
+	return false;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+int MapLoader::CheckCachedBlockMap()
+{
+	const uint8_t *chunk;
+	uint32_t size;
+
+	if (!FindLevelCacheChunk("BMAP", chunk, size)) return 0;
+
+	FLevelCacheReader fr = { chunk, size };
+	uint32_t count = fr.ReadLong();
+	if (count < 4 || count != (size - 4) / 4) return 0;
+
+	int *blockmap = new int[count];
+	for (uint32_t i = 0; i < count; i++)
+	{
+		blockmap[i] = (int)fr.ReadLong();
+	}
+	Level->blockmap.blockmaplump = blockmap;
+
+	if (!Level->blockmap.VerifyBlockMap(count, Level->lines.Size()))
+	{
+		delete[] Level->blockmap.blockmaplump;
+		Level->blockmap.blockmaplump = nullptr;
+		return 0;
+	}
+	return count;
+}
+
+//==========================================================================
+//
+// Restores the output of CreateSections.
+//
+//==========================================================================
+
+bool MapLoader::CheckCachedSections()
+{
+	const uint8_t *chunk;
+	uint32_t size;
+
+	if (!FindLevelCacheChunk("SECT", chunk, size)) return false;
+
+	FLevelCacheReader fr = { chunk, size };
+	auto &sections = Level->sections;
+	const uint32_t numsections = fr.ReadLong();
+	const uint32_t numlines = fr.ReadLong();
+	const uint32_t numsides = fr.ReadLong();
+	const uint32_t numsubsectors = fr.ReadLong();
+
+	// Each entry takes at least 4 bytes so this rejects nonsensical counts before anything gets allocated.
+	if (fr.error || numsections == 0 || numsubsectors != Level->subsectors.Size() || uint64_t(numsections) + numlines + numsides + numsubsectors > size / 4)
+	{
+		return false;
+	}
+
+	sections.Clear();
+	sections.allSections.Resize(numsections);
+	sections.allLines.Resize(numlines);
+	sections.allSides.Resize(numsides);
+	sections.allSubsectors.Resize(numsubsectors);
+	sections.allIndices.Resize(2 * Level->sectors.Size());
+	sections.firstSectionForSectorPtr = &sections.allIndices[0];
+	sections.numberOfSectionForSectorPtr = &sections.allIndices[Level->sectors.Size()];
+
+	uint32_t firstline = 0, firstside = 0, firstsub = 0;
+	for (auto &section : sections.allSections)
+	{
+		section.sector = &Level->sectors[fr.ReadIndex(Level->sectors.Size())];
+		section.mapsection = (short)fr.ReadLong();
+		uint32_t nlines = fr.ReadLong();
+		uint32_t nsides = fr.ReadLong();
+		uint32_t nsubs = fr.ReadLong();
+		section.bounds.left = fr.ReadDouble();
+		section.bounds.top = fr.ReadDouble();
+		section.bounds.right = fr.ReadDouble();
+		section.bounds.bottom = fr.ReadDouble();
+		if (fr.error || nlines > numlines - firstline || nsides > numsides - firstside || nsubs > numsubsectors - firstsub) break;
+
+		section.segments.Set(sections.allLines.Data() + firstline, nlines);
+		section.sides.Set(sections.allSides.Data() + firstside, nsides);
+		section.subsectors.Set(sections.allSubsectors.Data() + firstsub, nsubs);
+		firstline += nlines;
+		firstside += nsides;
+		firstsub += nsubs;
+
+		section.lighthead = nullptr;
+		section.vertexindex = -1;
+		section.vertexcount = 0;
+		section.validcount = 0;
+		section.hacked = false;
+		section.flags = 0;
+	}
+	if (!fr.error && (firstline != numlines || firstside != numsides || firstsub != numsubsectors)) fr.error = true;
+
+	for (unsigned i = 0; i < numlines && !fr.error; i++)
+	{
+		auto &line = sections.allLines[i];
+		line.start = &Level->vertexes[fr.ReadIndex(Level->vertexes.Size())];
+		line.end = &Level->vertexes[fr.ReadIndex(Level->vertexes.Size())];
+		uint32_t partner = fr.ReadIndex(numlines, true);
+		line.partner = partner == UINT_MAX ? nullptr : &sections.allLines[partner];
+		line.section = &sections.allSections[fr.ReadIndex(numsections)];
+		uint32_t side = fr.ReadIndex(Level->sides.Size(), true);
+		line.sidedef = side == UINT_MAX ? nullptr : &Level->sides[side];
+	}
+	for (unsigned i = 0; i < numsides && !fr.error; i++)
+	{
+		sections.allSides[i] = &Level->sides[fr.ReadIndex(Level->sides.Size())];
+	}
+	for (unsigned i = 0; i < numsubsectors && !fr.error; i++)
+	{
+		sections.allSubsectors[i] = &Level->subsectors[fr.ReadIndex(Level->subsectors.Size())];
+	}
+	for (unsigned i = 0; i < Level->sectors.Size() && !fr.error; i++)
+	{
+		int first = (int)fr.ReadLong();
+		uint32_t count = fr.ReadLong();
+		if (count > numsections || (count > 0 && (first < 0 || uint32_t(first) > numsections - count))) fr.error = true;
+		sections.firstSectionForSectorPtr[i] = first;
+		sections.numberOfSectionForSectorPtr[i] = count;
+	}
+	for (unsigned i = 0; i < numsubsectors && !fr.error; i++)
+	{
+		Level->subsectors[i].section = &sections.allSections[fr.ReadIndex(numsections)];
+	}
+
+	if (fr.error)
+	{
+		sections.Clear();
+		for (auto &sub : Level->subsectors) sub.section = nullptr;
+		return false;
+	}
 	return true;
 }
 
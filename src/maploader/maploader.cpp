@@ -59,6 +59,9 @@
 
 
 #include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include "maploader.h"
 #include "c_cvars.h"
 #include "actor.h"
@@ -79,6 +82,8 @@
 #include "swrenderer/r_swrenderer.h"
 #include "hwrenderer/data/flatvertices.h"
 #include "xlat/xlat.h"
+#include "parallel_for.h"
+#include "ctpl.h"
 
 enum
 {
@@ -2237,111 +2242,229 @@ void MapLoader::LoadSideDefs2 (MapData *map, FMissingTextureTracker &missingtex)
 //
 //===========================================================================
 
-static unsigned int BlockHash (TArray<int> *block)
+enum
 {
-	int hash = 0;
-	int *ar = &(*block)[0];
-	for (size_t i = 0; i < block->Size(); ++i)
-	{
-		hash = hash * 12235 + ar[i];
-	}
-	return hash & 0x7fffffff;
-}
+	BLOCKBITS = 7,
+	BLOCKSIZE = 128
+};
 
-static bool BlockCompare (TArray<int> *block1, TArray<int> *block2)
+//===========================================================================
+//
+// Calls visit for every block a line passes through.
+// Each block is visited at most once.
+//
+//===========================================================================
+
+template<class Visit>
+static void TraceBlockLine (int x1, int y1, int x2, int y2, int minx, int miny, int bmapwidth, Visit &&visit)
 {
-	size_t size = block1->Size();
+	int dx = x2 - x1;
+	int dy = y2 - y1;
+	int bx = (x1 - minx) >> BLOCKBITS;
+	int by = (y1 - miny) >> BLOCKBITS;
+	int bx2 = (x2 - minx) >> BLOCKBITS;
+	int by2 = (y2 - miny) >> BLOCKBITS;
+
+	int block = bx + by * bmapwidth;
+	int endblock = bx2 + by2 * bmapwidth;
 
-	if (size != block2->Size())
+	if (block == endblock)	// Single block
 	{
-		return false;
+		visit (block);
 	}
-	if (size == 0)
+	else if (by == by2)		// Horizontal line
 	{
-		return true;
+		if (bx > bx2)
+		{
+			swapvalues (block, endblock);
+		}
+		do
+		{
+			visit (block);
+			block += 1;
+		} while (block <= endblock);
 	}
-	int *ar1 = &(*block1)[0];
-	int *ar2 = &(*block2)[0];
-	for (size_t i = 0; i < size; ++i)
+	else if (bx == bx2)	// Vertical line
 	{
-		if (ar1[i] != ar2[i])
+		if (by > by2)
 		{
-			return false;
+			swapvalues (block, endblock);
 		}
+		do
+		{
+			visit (block);
+			block += bmapwidth;
+		} while (block <= endblock);
 	}
-	return true;
+	else				// Diagonal line
+	{
+		int xchange = (dx < 0) ? -1 : 1;
+		int ychange = (dy < 0) ? -1 : 1;
+		int ymove = ychange * bmapwidth;
+		int adx = abs (dx);
+		int ady = abs (dy);
+
+		if (adx == ady)		// 45 degrees
+		{
+			int xb = (x1 - minx) & (BLOCKSIZE-1);
+			int yb = (y1 - miny) & (BLOCKSIZE-1);
+			if (dx < 0)
+			{
+				xb = BLOCKSIZE-xb;
+			}
+			if (dy < 0)
+			{
+				yb = BLOCKSIZE-yb;
+			}
+			if (xb < yb)
+				adx--;
+		}
+		if (adx >= ady)		// X-major
+		{
+			int yadd = dy < 0 ? -1 : BLOCKSIZE;
+			do
+			{
+				int stop = (Scale ((by << BLOCKBITS) + yadd - (y1 - miny), dx, dy) + (x1 - minx)) >> BLOCKBITS;
+				while (bx != stop)
+				{
+					visit (block);
+					block += xchange;
+					bx += xchange;
+				}
+				visit (block);
+				block += ymove;
+				by += ychange;
+			} while (by != by2);
+			while (block != endblock)
+			{
+				visit (block);
+				block += xchange;
+			}
+			visit (block);
+		}
+		else					// Y-major
+		{
+			int xadd = dx < 0 ? -1 : BLOCKSIZE;
+			do
+			{
+				int stop = (Scale ((bx << BLOCKBITS) + xadd - (x1 - minx), dy, dx) + (y1 - miny)) >> BLOCKBITS;
+				while (by != stop)
+				{
+					visit (block);
+					block += ymove;
+					by += ychange;
+				}
+				visit (block);
+				block += xchange;
+				bx += xchange;
+			} while (bx != bx2);
+			while (block != endblock)
+			{
+				visit (block);
+				block += ymove;
+			}
+			visit (block);
+		}
+	}
+}
+
+//===========================================================================
+//
+// The block lists are stored back to back in lines, and block i's list
+// is lines[starts[i]] up to lines[starts[i+1]].
+//
+//===========================================================================
+
+static unsigned int BlockHash (const int *ar, unsigned int size)
+{
+	unsigned int hash = 0;
+	for (unsigned int i = 0; i < size; ++i)
+	{
+		hash = hash * 12235 + ar[i];
+	}
+	return hash;
 }
 
-static void CreatePackedBlockmap (TArray<int> &BlockMap, TArray<int> *blocks, int bmapwidth, int bmapheight)
+static void CreatePackedBlockmap (TArray<int> &BlockMap, const TArray<int> &lines, const TArray<unsigned int> &starts, int bmapwidth, int bmapheight)
 {
-	int buckets[4096];
-	int hashblock;
-	TArray<int> *block;
-	int zero = 0;
-	int terminator = -1;
-	int *array;
-	int i, hash;
-	int hashed = 0, nothashed = 0;
+	const int numblocks = bmapwidth * bmapheight;
+	TArray<unsigned int> hashes(numblocks, true);
+	TArray<int> owners(numblocks, true);
 
-	TArray<int> hashes(bmapwidth * bmapheight, true);
+	parallel_for(numblocks, [&](int i)
+	{
+		hashes[i] = BlockHash (lines.Data() + starts[i], starts[i+1] - starts[i]);
+	});
 
-	memset (hashes.Data(), 0xff, sizeof(int)*bmapwidth*bmapheight);
-	memset (buckets, 0xff, sizeof(buckets));
+	// Every block is mapped to the first block with the same list. Since only
+	// those get written out, the result does not depend on the hash table's size.
+	unsigned int numbuckets = 4096;
+	while (numbuckets < (unsigned int)numblocks) numbuckets <<= 1;
+	TArray<int> buckets(numbuckets, true);
+	TArray<int> chain(numblocks, true);
+	memset (buckets.Data(), 0xff, sizeof(int)*numbuckets);
 
-	for (i = 0; i < bmapwidth * bmapheight; ++i)
+	unsigned int packedsize = BlockMap.Size() + numblocks;
+	for (int i = 0; i < numblocks; ++i)
 	{
-		block = &blocks[i];
-		hash = BlockHash (block) % 4096;
-		hashblock = buckets[hash];
+		const unsigned int size = starts[i+1] - starts[i];
+		int &bucket = buckets[hashes[i] & (numbuckets - 1)];
+		int hashblock = bucket;
 		while (hashblock != -1)
 		{
-			if (BlockCompare (block, &blocks[hashblock]))
+			if (hashes[hashblock] == hashes[i] && starts[hashblock+1] - starts[hashblock] == size &&
+				(size == 0 || !memcmp (lines.Data() + starts[hashblock], lines.Data() + starts[i], size * sizeof(int))))
 			{
 				break;
 			}
-			hashblock = hashes[hashblock];
+			hashblock = chain[hashblock];
 		}
 		if (hashblock != -1)
 		{
-			BlockMap[4+i] = BlockMap[4+hashblock];
-			hashed++;
+			owners[i] = hashblock;
+		}
+		else
+		{
+			chain[i] = bucket;
+			bucket = i;
+			owners[i] = i;
+			packedsize += size + 2;
+		}
+	}
+
+	unsigned int pos = BlockMap.Size() + numblocks;
+	BlockMap.Resize (packedsize);
+	for (int i = 0; i < numblocks; ++i)
+	{
+		if (owners[i] != i)
+		{
+			BlockMap[4+i] = BlockMap[4+owners[i]];
 		}
 		else
 		{
-			hashes[i] = buckets[hash];
-			buckets[hash] = i;
-			BlockMap[4+i] = BlockMap.Size ();
-			BlockMap.Push (zero);
-			array = &(*block)[0];
-			for (size_t j = 0; j < block->Size(); ++j)
+			const unsigned int size = starts[i+1] - starts[i];
+			BlockMap[4+i] = pos;
+			BlockMap[pos++] = 0;
+			if (size > 0)
 			{
-				BlockMap.Push (array[j]);
+				memcpy (&BlockMap[pos], lines.Data() + starts[i], size * sizeof(int));
+				pos += size;
 			}
-			BlockMap.Push (terminator);
-			nothashed++;
+			BlockMap[pos++] = -1;
 		}
 	}
 }
 
 
-void MapLoader::CreateBlockMap ()
+int MapLoader::CreateBlockMap ()
 {
-	enum
-	{
-		BLOCKBITS = 7,
-		BLOCKSIZE = 128
-	};
-
-	TArray<int> *block, *endblock;
-	TArray<TArray<int>> BlockLists;
 	int adder;
 	int bmapwidth, bmapheight;
 	double dminx, dmaxx, dminy, dmaxy;
 	int minx, maxx, miny, maxy;
-	int line;
 
 	if (Level->vertexes.Size() == 0)
-		return;
+		return 0;
 
 	// Find map extents for the blockmap
 	dminx = dmaxx = Level->vertexes[0].fX();
@@ -2363,139 +2486,70 @@ void MapLoader::CreateBlockMap ()
 	bmapwidth =	 ((maxx - minx) >> BLOCKBITS) + 1;
 	bmapheight = ((maxy - miny) >> BLOCKBITS) + 1;
 
-	TArray<int> BlockMap (bmapwidth * bmapheight * 3 + 4);
+	const int numblocks = bmapwidth * bmapheight;
+	const int numlines = (int)Level->lines.Size();
+
+	TArray<int> BlockMap (numblocks * 3 + 4);
 
 	adder = minx;			BlockMap.Push (adder);
 	adder = miny;			BlockMap.Push (adder);
 	adder = bmapwidth;		BlockMap.Push (adder);
 	adder = bmapheight;		BlockMap.Push (adder);
 
-	BlockLists.Resize(bmapwidth * bmapheight);
+	// The block lists are built with a counting sort: First count how many
+	// lines touch each block, then give each block its own range and fill
+	// them in. Both passes run over all lines in parallel.
+	auto traceline = [&](int line, auto &&visit)
+	{
+		TraceBlockLine (int(Level->lines[line].v1->fX()), int(Level->lines[line].v1->fY()),
+			int(Level->lines[line].v2->fX()), int(Level->lines[line].v2->fY()), minx, miny, bmapwidth, visit);
+	};
 
-	for (line = 0; line < (int)Level->lines.Size(); ++line)
+	std::unique_ptr<std::atomic<unsigned int>[]> counts(new std::atomic<unsigned int>[numblocks]);
+	for (int i = 0; i < numblocks; ++i)
 	{
-		int x1 = int(Level->lines[line].v1->fX());
-		int y1 = int(Level->lines[line].v1->fY());
-		int x2 = int(Level->lines[line].v2->fX());
-		int y2 = int(Level->lines[line].v2->fY());
-		int dx = x2 - x1;
-		int dy = y2 - y1;
-		int bx = (x1 - minx) >> BLOCKBITS;
-		int by = (y1 - miny) >> BLOCKBITS;
-		int bx2 = (x2 - minx) >> BLOCKBITS;
-		int by2 = (y2 - miny) >> BLOCKBITS;
+		counts[i].store(0, std::memory_order_relaxed);
+	}
 
-		block = &BlockLists[bx + by * bmapwidth];
-		endblock = &BlockLists[bx2 + by2 * bmapwidth];
+	parallel_for(numlines, [&](int line)
+	{
+		traceline (line, [&](int block) { counts[block].fetch_add(1, std::memory_order_relaxed); });
+	});
 
-		if (block == endblock)	// Single block
-		{
-			block->Push (line);
-		}
-		else if (by == by2)		// Horizontal line
-		{
-			if (bx > bx2)
-			{
-				swapvalues (block, endblock);
-			}
-			do
-			{
-				block->Push (line);
-				block += 1;
-			} while (block <= endblock);
-		}
-		else if (bx == bx2)	// Vertical line
-		{
-			if (by > by2)
-			{
-				swapvalues (block, endblock);
-			}
-			do
-			{
-				block->Push (line);
-				block += bmapwidth;
-			} while (block <= endblock);
-		}
-		else				// Diagonal line
-		{
-			int xchange = (dx < 0) ? -1 : 1;
-			int ychange = (dy < 0) ? -1 : 1;
-			int ymove = ychange * bmapwidth;
-			int adx = abs (dx);
-			int ady = abs (dy);
+	TArray<unsigned int> starts(numblocks + 1, true);
+	unsigned int total = 0;
+	for (int i = 0; i < numblocks; ++i)
+	{
+		starts[i] = total;
+		total += counts[i].load(std::memory_order_relaxed);
+		counts[i].store(starts[i], std::memory_order_relaxed);
+	}
+	starts[numblocks] = total;
 
-			if (adx == ady)		// 45 degrees
-			{
-				int xb = (x1 - minx) & (BLOCKSIZE-1);
-				int yb = (y1 - miny) & (BLOCKSIZE-1);
-				if (dx < 0)
-				{
-					xb = BLOCKSIZE-xb;
-				}
-				if (dy < 0)
-				{
-					yb = BLOCKSIZE-yb;
-				}
-				if (xb < yb)
-					adx--;
-			}
-			if (adx >= ady)		// X-major
-			{
-				int yadd = dy < 0 ? -1 : BLOCKSIZE;
-				do
-				{
-					int stop = (Scale ((by << BLOCKBITS) + yadd - (y1 - miny), dx, dy) + (x1 - minx)) >> BLOCKBITS;
-					while (bx != stop)
-					{
-						block->Push (line);
-						block += xchange;
-						bx += xchange;
-					}
-					block->Push (line);
-					block += ymove;
-					by += ychange;
-				} while (by != by2);
-				while (block != endblock)
-				{
-					block->Push (line);
-					block += xchange;
-				}
-				block->Push (line);
-			}
-			else					// Y-major
-			{
-				int xadd = dx < 0 ? -1 : BLOCKSIZE;
-				do
-				{
-					int stop = (Scale ((bx << BLOCKBITS) + xadd - (x1 - minx), dy, dx) + (y1 - miny)) >> BLOCKBITS;
-					while (by != stop)
-					{
-						block->Push (line);
-						block += ymove;
-						by += ychange;
-					}
-					block->Push (line);
-					block += xchange;
-					bx += xchange;
-				} while (bx != bx2);
-				while (block != endblock)
-				{
-					block->Push (line);
-					block += ymove;
-				}
-				block->Push (line);
-			}
+	TArray<int> lines(total, true);
+	parallel_for(numlines, [&](int line)
+	{
+		traceline (line, [&](int block) { lines[counts[block].fetch_add(1, std::memory_order_relaxed)] = line; });
+	});
+
+	// The lines got stored in no particular order, but each list must be sorted
+	// by line number, as if the lines had been added one by one.
+	parallel_for(numblocks, [&](int i)
+	{
+		if (starts[i+1] - starts[i] > 1)
+		{
+			std::sort (lines.Data() + starts[i], lines.Data() + starts[i+1]);
 		}
-	}
+	});
 
-	BlockMap.Reserve (bmapwidth * bmapheight);
-	CreatePackedBlockmap (BlockMap, BlockLists.Data(), bmapwidth, bmapheight);
+	CreatePackedBlockmap (BlockMap, lines, starts, bmapwidth, bmapheight);
 
 	Level->blockmap.blockmaplump = new int[BlockMap.Size()];
 	for (unsigned int ii = 0; ii < BlockMap.Size(); ++ii)
 	{
 		Level->blockmap.blockmaplump[ii] = BlockMap[ii];
 	}
+	return BlockMap.Size();
 }
 
 
@@ -2592,19 +2646,27 @@ bool FBlockmap::VerifyBlockMap(int count, unsigned numlines)
 //
 // killough 3/30/98: Rewritten to remove blockmap limit
 //
+// Returns false if the blockmap needs to be generated with CreateBlockMap.
+// cacheblockmap is set if the generated blockmap should be cached.
+//
 //===========================================================================
 
-void MapLoader::LoadBlockMap (MapData * map)
+bool MapLoader::LoadBlockMap (MapData * map, bool &cacheblockmap)
 {
 	int count = map->Size(ML_BLOCKMAP);
 
+	cacheblockmap = false;
 	if (ForceNodeBuild || genblockmap ||
 		count/2 >= 0x10000 || count == 0 ||
 		Args->CheckParm("-blockmap")
 		)
 	{
-		DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-		CreateBlockMap ();
+		if (!UseLevelCache || (CachedBlockMapSize = CheckCachedBlockMap()) == 0)
+		{
+			DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
+			cacheblockmap = UseLevelCache;
+			return false;
+		}
 	}
 	else
 	{
@@ -2634,10 +2696,25 @@ void MapLoader::LoadBlockMap (MapData * map)
 		if (!Level->blockmap.VerifyBlockMap(count, Level->lines.Size()))
 		{
 			DPrintf (DMSG_SPAMMY, "Generating BLOCKMAP\n");
-			CreateBlockMap();
+			delete[] Level->blockmap.blockmaplump;
+			Level->blockmap.blockmaplump = nullptr;
+			return false;
 		}
 
 	}
+	return true;
+}
+
+//===========================================================================
+//
+// Sets up the blockmap's header fields and mobj chains once its
+// lump data has been loaded or created.
+//
+//===========================================================================
+
+void MapLoader::InitBlockMap ()
+{
+	int count;
 
 	Level->blockmap.bmaporgx = Level->blockmap.blockmaplump[0];
 	Level->blockmap.bmaporgy = Level->blockmap.blockmaplump[1];
@@ -2938,6 +3015,38 @@ void MapLoader::CalcIndices()
 	}
 }
 
+//==========================================================================
+//
+// Level loading work that can run next to the main thread's.
+//
+//==========================================================================
+
+static ctpl::thread_pool &LevelLoadPool()
+{
+	static ctpl::thread_pool pool(1);
+	return pool;
+}
+
+//==========================================================================
+//
+// Prints how long each stage of LoadLevel took when developer is set.
+//
+//==========================================================================
+
+class FLoadStageTimer
+{
+public:
+	void Done(const char *stage)
+	{
+		uint64_t now = I_nsTime();
+		DPrintf(DMSG_NOTIFY, "%s took %.3f ms\n", stage, (now - Start) * 1e-6);
+		Start = now;
+	}
+
+private:
+	uint64_t Start = I_nsTime();
+};
+
 //==========================================================================
 //
 //
@@ -2947,6 +3056,7 @@ void MapLoader::CalcIndices()
 void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 {
 	const int *oldvertextable  = nullptr;
+	FLoadStageTimer timer;
 
 	// note: most of this ordering is important 
 	ForceNodeBuild = gennodes;
@@ -3011,6 +3121,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 
 
 	LoadStrifeConversations(map, lumpname);
+	timer.Done("Scripts and conversations");
 
 	FMissingTextureTracker missingtex;
 
@@ -3045,6 +3156,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	LoopSidedefs(true);
 
 	SummarizeMissingTextures(missingtex);
+	timer.Done("Map data");
 	bool reloop = false;
 
 	if (!ForceNodeBuild)
@@ -3178,8 +3290,35 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	
 	// set the head node for gameplay purposes. If the separate gamenodes array is not empty, use that, otherwise use the render nodes.
 	Level->headgamenode = Level->gamenodes.Size() > 0 ? &Level->gamenodes[Level->gamenodes.Size() - 1] : Level->nodes.Size() ? &Level->nodes[Level->nodes.Size() - 1] : nullptr;
+	timer.Done("Nodes");
 
-	LoadBlockMap(map);
+	// A generated blockmap only depends on the lines and vertexes, which do not
+	// change anymore, so it is created on a worker while the sectors get set up.
+	if (UseLevelCache)
+	{
+		ReadLevelCache(map);
+	}
+
+	bool cacheblockmap;
+	uint64_t blockmaptime = 0;
+	std::future<int> blockmapjob;
+	if (!LoadBlockMap(map, cacheblockmap))
+	{
+		blockmapjob = LevelLoadPool().push([this, &blockmaptime](int)
+		{
+			uint64_t start = I_nsTime();
+			int size = CreateBlockMap();
+			blockmaptime = I_nsTime() - start;
+			return size;
+		});
+	}
+	// Wait for the worker if one of the following steps aborts, so that it is done before the level gets destroyed.
+	struct FJobWaiter
+	{
+		std::future<int> &job;
+		~FJobWaiter() { if (job.valid()) job.wait(); }
+	} blockmapwaiter = { blockmapjob };
+	timer.Done("Blockmap loading");
 
 	LoadReject(map, false);
 	GroupLines(false);
@@ -3190,6 +3329,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 
 	// Create the item indices, after the last function which may change the data has run.
 	CalcIndices();
+	timer.Done("Sector setup");
 
 	Level->bodyqueslot = 0;
 	// phares 8/10/98: Clear body queue so the corpses from previous games are
@@ -3198,7 +3338,32 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	for (auto & p : Level->bodyque)
 		p = nullptr;
 
-	CreateSections(Level);
+	bool cachedsections = UseLevelCache && CheckCachedSections();
+	if (!cachedsections)
+	{
+		CreateSections(Level);
+	}
+	timer.Done("Sections");
+
+	int blockmapsize = CachedBlockMapSize;
+	if (blockmapjob.valid())
+	{
+		int size = blockmapjob.get();
+		DPrintf(DMSG_NOTIFY, "Blockmap generation took %.3f ms\n", blockmaptime * 1e-6);
+		if (cacheblockmap && size > 0)
+		{
+			blockmapsize = size;
+		}
+		timer.Done("Waiting for the blockmap");
+	}
+	// Rewrite the level cache only if some of its contents had to be created.
+	if (UseLevelCache && (!cachedsections || blockmapsize != CachedBlockMapSize))
+	{
+		CreateLevelCache(map, blockmapsize);
+		timer.Done("Writing the level cache");
+	}
+	LevelCache.Reset();
+	InitBlockMap();
 
 	// [RH] Spawn slope creating things first.
 	SpawnSlopeMakers(&MapThingsConverted[0], &MapThingsConverted[MapThingsConverted.Size()], oldvertextable);
@@ -3208,6 +3373,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	Spawn3DFloors();
 
 	SpawnThings(position);
+	timer.Done("Things");
 
 	for (int i = 0; i < MAXPLAYERS; ++i)
 	{
@@ -3224,6 +3390,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 
 	// set up world state
 	SpawnSpecials();
+	timer.Done("Specials");
 
 	// disable reflective planes on sloped sectors.
 	for (auto &sec : Level->sectors)
@@ -3240,13 +3407,15 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 
 	InitRenderInfo();				// create hardware independent renderer resources for the level. This must be done BEFORE the PolyObj Spawn!!!
 	Level->ClearDynamic3DFloorData();	// CreateVBO must be run on the plain 3D floor data.
-	screen->mVertexData->CreateVBO(Level->sectors);
+	screen->mVertexData->CreateVBO(Level->sectors, Level->segs);
 
 	for (auto &sec : Level->sectors)
 	{
 		P_Recalculate3DFloors(&sec);
 	}
 
+	timer.Done("Render data");
+
 	SWRenderer->SetColormap(Level);	//The SW renderer needs to do some special setup for the level's default colormap.
 	InitPortalGroups(Level);
 	P_InitHealthGroups(Level);
@@ -3255,4 +3424,5 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	PO_Init();				// Initialize the polyobjs
 	if (!Level->IsReentering())
 		Level->FinalizePortals();	// finalize line portals after polyobjects have been initialized. This info is needed for properly flagging them.
+	timer.Done("Portals and polyobjects");
 }
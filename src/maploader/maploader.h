@@ -121,6 +121,10 @@ public:	// for the scripted compatibility system these two members need to be pu
 	TArray<FMapThing> MapThingsConverted;
 	bool ForceNodeBuild = false;
 private:
+	bool UseLevelCache = false;	// set when this level's nodes were loaded from or written to the node cache
+	TArray<uint8_t> LevelCache;	// uncompressed contents of the level cache file
+	uint32_t LevelCacheKey[7];	// level sizes the cache is valid for, as they were before FixHoles
+	int CachedBlockMapSize = 0;
 
 	// Extradata loader
 	TMap<int, EDLinedef> EDLines;
@@ -166,6 +170,11 @@ private:
 	bool LoadNodes(FileReader &lump);
 	bool DoLoadGLNodes(FileReader * lumps);
 	void CreateCachedNodes(MapData *map);
+	void CreateLevelCache(MapData *map, int count);
+	void ReadLevelCache(MapData *map);
+	bool FindLevelCacheChunk(const char *id, const uint8_t *&chunk, uint32_t &size);
+	int CheckCachedBlockMap();
+	bool CheckCachedSections();
 
 	// Render info
 	void PrepareSectorData();
@@ -229,7 +238,7 @@ private:
 	void AllocateSideDefs(MapData *map, int count);
 	void ProcessSideTextures(bool checktranmap, side_t *sd, sector_t *sec, intmapsidedef_t *msd, int special, int tag, short *alpha, FMissingTextureTracker &missingtex);
 	void SetMapThingUserData(AActor *actor, unsigned udi);
-	void CreateBlockMap();
+	int CreateBlockMap();
 	void PO_Init(void);
 
 	// During map init the items' own Index functions should not be used.
@@ -293,7 +302,8 @@ public:
 	void LoadLineDefs2(MapData * map);
 	void LoopSidedefs(bool firstloop);
 	void LoadSideDefs2(MapData *map, FMissingTextureTracker &missingtex);
-	void LoadBlockMap(MapData * map);
+	bool LoadBlockMap(MapData * map, bool &cacheblockmap);
+	void InitBlockMap();
 	void LoadReject(MapData * map, bool junk);
 	void LoadBehavior(MapData * map);
 	void GetPolySpots(MapData * map, TArray<FNodeBuilder::FPolyStart> &spots, TArray<FNodeBuilder::FPolyStart> &anchors);
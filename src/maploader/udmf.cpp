@@ -177,10 +177,32 @@ void UDMFParserBase::Skip()
 //
 //===========================================================================
 
+FName UDMFParserBase::GetKeyName()
+{
+	if (sc.StringLen == 0 || sc.StringLen >= (int)sizeof(FKeyCacheEntry::Text))
+	{
+		return sc.String;
+	}
+
+	uint32_t hash = 2166136261u;
+	for (int i = 0; i < sc.StringLen; i++)
+	{
+		hash = (hash ^ (uint8_t)sc.String[i]) * 16777619u;
+	}
+
+	auto &entry = KeyCache[hash & (countof(KeyCache) - 1)];
+	if (memcmp(entry.Text, sc.String, sc.StringLen + 1))
+	{
+		memcpy(entry.Text, sc.String, sc.StringLen + 1);
+		entry.Name = sc.String;
+	}
+	return entry.Name;
+}
+
 FName UDMFParserBase::ParseKey(bool checkblock, bool *isblock)
 {
 	sc.MustGetString();
-	FName key = sc.String;
+	FName key = GetKeyName();
 	if (checkblock)
 	{
 		if (sc.CheckToken('{'))
@@ -212,7 +234,8 @@ FName UDMFParserBase::ParseKey(bool checkblock, bool *isblock)
 	}
 	if (sc.TokenType == TK_StringConst)
 	{
-		parsedString = sc.String;
+		parsedString.Resize(sc.StringLen + 1);
+		memcpy(parsedString.Data(), sc.String, sc.StringLen + 1);
 	}
 	int savedtoken = sc.TokenType;
 	sc.MustGetToken(';');
@@ -277,7 +300,7 @@ const char *UDMFParserBase::CheckString(const char *key)
 	{
 		sc.ScriptMessage("String value expected for key '%s'", key);
 	}
-	return parsedString;
+	return parsedString.Size() > 0 ? parsedString.Data() : "";
 }
 
 //===========================================================================
@@ -434,7 +457,7 @@ public:
 			break;
 		default:
 		case TK_StringConst:
-			ukey = parsedString;
+			ukey = parsedString.Size() > 0 ? parsedString.Data() : "";
 			break;
 		case TK_True:
 			ukey = 1;
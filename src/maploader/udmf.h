@@ -10,10 +10,20 @@ protected:
 	FScanner sc;
 	FName namespc = NAME_None;
 	int namespace_bits;
-	FString parsedString;
+	TArray<char> parsedString;
 	bool BadCoordinates = false;
 
+	// Every block repeats the same few keys, so their names get cached
+	// by spelling instead of going through the name table each time.
+	struct FKeyCacheEntry
+	{
+		char Text[28];
+		FName Name;
+	};
+	FKeyCacheEntry KeyCache[256] = {};
+
 	void Skip();
+	FName GetKeyName();
 	FName ParseKey(bool checkblock = false, bool *isblock = NULL);
 	int CheckInt(const char *key);
 	double CheckFloat(const char *key);
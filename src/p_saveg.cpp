@@ -59,9 +59,73 @@
 #include "p_destructible.h"
 #include "r_sky.h"
 #include "version.h"
+#include "i_time.h"
 #include "fragglescript/t_script.h"
 
 EXTERN_CVAR(Bool, save_formatted)
+EXTERN_CVAR(Bool, save_binary)
+
+//==========================================================================
+//
+// Stands in for the serializer to find out whether a line, side or sector
+// differs from its load state, without producing any output. This way the
+// check works from the same list of fields that gets saved.
+// Anything it cannot compare against the load state counts as changed when
+// it is set, just like the serializer always writes it in that case.
+//
+//==========================================================================
+
+struct FChangeCheck
+{
+	bool changed = false;
+
+	template<class T>
+	FChangeCheck &operator()(const char *key, T &obj, T &def)
+	{
+		changed = changed || memcmp(&obj, &def, sizeof(T)) != 0;
+		return *this;
+	}
+
+	template<class T>
+	FChangeCheck &operator()(const char *key, T &obj)
+	{
+		changed = changed || !nullcmp(&obj, sizeof(T));
+		return *this;
+	}
+
+	template<class T, class TT>
+	FChangeCheck &operator()(const char *key, TArray<T, TT> &obj)
+	{
+		changed = changed || obj.Size() > 0;
+		return *this;
+	}
+
+	FChangeCheck &Args(const char *key, int *args, int *defargs, int special)
+	{
+		changed = changed || memcmp(args, defargs, 5 * sizeof(int)) != 0;
+		return *this;
+	}
+
+	FChangeCheck &Terrain(const char *key, int &terrain, int *def)
+	{
+		changed = changed || terrain != *def;
+		return *this;
+	}
+
+	template<class T>
+	FChangeCheck &Array(const char *key, T *obj, T *def, int count, bool fullcompare = false)
+	{
+		changed = changed || !fullcompare || memcmp(obj, def, count * sizeof(T)) != 0;
+		return *this;
+	}
+
+	template<class T>
+	FChangeCheck &Array(const char *key, T *obj, int count, bool fullcompare = false)
+	{
+		changed = changed || !fullcompare || !nullcmp(obj, count * sizeof(T));
+		return *this;
+	}
+};
 
 //==========================================================================
 //
@@ -69,21 +133,27 @@ EXTERN_CVAR(Bool, save_formatted)
 //
 //==========================================================================
 
+template<class Archive>
+static void SerializeFields(Archive &arc, line_t &line, line_t *def)
+{
+	arc("flags", line.flags, def->flags)
+		("activation", line.activation, def->activation)
+		("special", line.special, def->special)
+		("alpha", line.alpha, def->alpha)
+		.Args("args", line.args, def->args, line.special)
+		("portalindex", line.portalindex, def->portalindex)
+		("locknumber", line.locknumber, def->locknumber)
+		("health", line.health, def->health);
+		// Unless the map loader is changed the sidedef references will not change between map loads so there's no need to save them.
+		//.Array("sides", line.sidedef, 2)
+}
+
 FSerializer &Serialize(FSerializer &arc, const char *key, line_t &line, line_t *def)
 {
 	if (arc.BeginObject(key))
 	{
-		arc("flags", line.flags, def->flags)
-			("activation", line.activation, def->activation)
-			("special", line.special, def->special)
-			("alpha", line.alpha, def->alpha)
-			.Args("args", line.args, def->args, line.special)
-			("portalindex", line.portalindex, def->portalindex)
-			("locknumber", line.locknumber, def->locknumber)
-			("health", line.health, def->health)
-			// Unless the map loader is changed the sidedef references will not change between map loads so there's no need to save them.
-			//.Array("sides", line.sidedef, 2)
-			.EndObject();
+		SerializeFields(arc, line, def);
+		arc.EndObject();
 	}
 	return arc;
 
@@ -125,19 +195,25 @@ FSerializer &Serialize(FSerializer &arc, const char *key, side_t::part &part, si
 //
 //==========================================================================
 
+template<class Archive>
+static void SerializeFields(Archive &arc, side_t &side, side_t *def)
+{
+	arc.Array("textures", side.textures, def->textures, 3, true)
+		("light", side.Light, def->Light)
+		("flags", side.Flags, def->Flags)
+		// These also remain identical across map loads
+		//("leftside", side.LeftSide)
+		//("rightside", side.RightSide)
+		//("index", side.Index)
+		("attacheddecals", side.AttachedDecals);
+}
+
 FSerializer &Serialize(FSerializer &arc, const char *key, side_t &side, side_t *def)
 {
 	if (arc.BeginObject(key))
 	{
-		arc.Array("textures", side.textures, def->textures, 3, true)
-			("light", side.Light, def->Light)
-			("flags", side.Flags, def->Flags)
-			// These also remain identical across map loads
-			//("leftside", side.LeftSide)
-			//("rightside", side.RightSide)
-			//("index", side.Index)
-			("attacheddecals", side.AttachedDecals)
-			.EndObject();
+		SerializeFields(arc, side, def);
+		arc.EndObject();
 	}
 	return arc;
 }
@@ -250,65 +326,129 @@ FSerializer &Serialize(FSerializer &arc, const char *key, secplane_t &p, secplan
 //
 //==========================================================================
 
+template<class Archive>
+static void SerializeFields(Archive &arc, sector_t &p, sector_t *def)
+{
+	arc("floorplane", p.floorplane, def->floorplane)
+		("ceilingplane", p.ceilingplane, def->ceilingplane)
+		("lightlevel", p.lightlevel, def->lightlevel)
+		("special", p.special, def->special)
+		("seqtype", p.seqType, def->seqType)
+		("seqname", p.SeqName, def->SeqName)
+		("friction", p.friction, def->friction)
+		("movefactor", p.movefactor, def->movefactor)
+		("stairlock", p.stairlock, def->stairlock)
+		("prevsec", p.prevsec, def->prevsec)
+		("nextsec", p.nextsec, def->nextsec)
+		.Array("planes", p.planes, def->planes, 2, true)
+		// These cannot change during play.
+		//("heightsec", p.heightsec)
+		//("bottommap", p.bottommap)
+		//("midmap", p.midmap)
+		//("topmap", p.topmap)
+		("damageamount", p.damageamount, def->damageamount)
+		("damageinterval", p.damageinterval, def->damageinterval)
+		("leakydamage", p.leakydamage, def->leakydamage)
+		("damagetype", p.damagetype, def->damagetype)
+		("sky", p.sky, def->sky)
+		("moreflags", p.MoreFlags, def->MoreFlags)
+		("flags", p.Flags, def->Flags)
+		.Array("portals", p.Portals, def->Portals, 2, true)
+		("zonenumber", p.ZoneNumber, def->ZoneNumber)
+		.Array("interpolations", p.interpolations, 4, true)
+		("soundtarget", p.SoundTarget)
+		("secacttarget", p.SecActTarget)
+		("floordata", p.floordata)
+		("ceilingdata", p.ceilingdata)
+		("lightingdata", p.lightingdata)
+		("fakefloor_sectors", p.e->FakeFloor.Sectors)
+		("midtexf_lines", p.e->Midtex.Floor.AttachedLines)
+		("midtexf_sectors", p.e->Midtex.Floor.AttachedSectors)
+		("midtexc_lines", p.e->Midtex.Ceiling.AttachedLines)
+		("midtexc_sectors", p.e->Midtex.Ceiling.AttachedSectors)
+		("linked_floor", p.e->Linked.Floor.Sectors)
+		("linked_ceiling", p.e->Linked.Ceiling.Sectors)
+		("colormap", p.Colormap, def->Colormap)
+		.Array("specialcolors", p.SpecialColors, def->SpecialColors, 5, true)
+		.Array("additivecolors", p.AdditiveColors, def->AdditiveColors, 5, true)
+		("gravity", p.gravity, def->gravity)
+		.Terrain("floorterrain", p.terrainnum[0], &def->terrainnum[0])
+		.Terrain("ceilingterrain", p.terrainnum[1], &def->terrainnum[1])
+		("healthfloor", p.healthfloor, def->healthfloor)
+		("healthceiling", p.healthceiling, def->healthceiling)
+		("health3d", p.health3d, def->health3d)
+		// GZDoom exclusive:
+		.Array("reflect", p.reflect, def->reflect, 2, true);
+}
+
 FSerializer &Serialize(FSerializer &arc, const char *key, sector_t &p, sector_t *def)
 {
 	if (arc.BeginObject(key))
 	{
-		arc("floorplane", p.floorplane, def->floorplane)
-			("ceilingplane", p.ceilingplane, def->ceilingplane)
-			("lightlevel", p.lightlevel, def->lightlevel)
-			("special", p.special, def->special)
-			("seqtype", p.seqType, def->seqType)
-			("seqname", p.SeqName, def->SeqName)
-			("friction", p.friction, def->friction)
-			("movefactor", p.movefactor, def->movefactor)
-			("stairlock", p.stairlock, def->stairlock)
-			("prevsec", p.prevsec, def->prevsec)
-			("nextsec", p.nextsec, def->nextsec)
-			.Array("planes", p.planes, def->planes, 2, true)
-			// These cannot change during play.
-			//("heightsec", p.heightsec)
-			//("bottommap", p.bottommap)
-			//("midmap", p.midmap)
-			//("topmap", p.topmap)
-			("damageamount", p.damageamount, def->damageamount)
-			("damageinterval", p.damageinterval, def->damageinterval)
-			("leakydamage", p.leakydamage, def->leakydamage)
-			("damagetype", p.damagetype, def->damagetype)
-			("sky", p.sky, def->sky)
-			("moreflags", p.MoreFlags, def->MoreFlags)
-			("flags", p.Flags, def->Flags)
-			.Array("portals", p.Portals, def->Portals, 2, true)
-			("zonenumber", p.ZoneNumber, def->ZoneNumber)
-			.Array("interpolations", p.interpolations, 4, true)
-			("soundtarget", p.SoundTarget)
-			("secacttarget", p.SecActTarget)
-			("floordata", p.floordata)
-			("ceilingdata", p.ceilingdata)
-			("lightingdata", p.lightingdata)
-			("fakefloor_sectors", p.e->FakeFloor.Sectors)
-			("midtexf_lines", p.e->Midtex.Floor.AttachedLines)
-			("midtexf_sectors", p.e->Midtex.Floor.AttachedSectors)
-			("midtexc_lines", p.e->Midtex.Ceiling.AttachedLines)
-			("midtexc_sectors", p.e->Midtex.Ceiling.AttachedSectors)
-			("linked_floor", p.e->Linked.Floor.Sectors)
-			("linked_ceiling", p.e->Linked.Ceiling.Sectors)
-			("colormap", p.Colormap, def->Colormap)
-			.Array("specialcolors", p.SpecialColors, def->SpecialColors, 5, true)
-			.Array("additivecolors", p.AdditiveColors, def->AdditiveColors, 5, true)
-			("gravity", p.gravity, def->gravity)
-			.Terrain("floorterrain", p.terrainnum[0], &def->terrainnum[0])
-			.Terrain("ceilingterrain", p.terrainnum[1], &def->terrainnum[1])
-			("healthfloor", p.healthfloor, def->healthfloor)
-			("healthceiling", p.healthceiling, def->healthceiling)
-			("health3d", p.health3d, def->health3d)
-			// GZDoom exclusive:
-			.Array("reflect", p.reflect, def->reflect, 2, true)
-			.EndObject();
+		SerializeFields(arc, p, def);
+		arc.EndObject();
 	}
 	return arc;
 }
 
+//==========================================================================
+//
+// Lines, sides and sectors are stored as changes against the state the
+// level had after being loaded. Entries that were not changed are
+// omitted entirely, everything else is keyed by its index.
+// Savegames from before this still contain the full arrays.
+//
+//==========================================================================
+
+template<class T>
+static bool HasChanges(T &item, T &def)
+{
+	FChangeCheck check;
+	SerializeFields(check, item, &def);
+	return check.changed;
+}
+
+template<class T>
+static void SerializeLevelChanges(FSerializer &arc, const char *key, const char *oldkey, TArray<T> &items, TArray<T> &pristine)
+{
+	FString index;
+
+	if (arc.isWriting())
+	{
+		if (arc.BeginObject(key))
+		{
+			for (unsigned i = 0; i < items.Size(); i++)
+			{
+				if (save_full || HasChanges(items[i], pristine[i]))
+				{
+					index.Format("%u", i);
+					arc.DeferObject(!save_full);
+					Serialize(arc, index.GetChars(), items[i], &pristine[i]);
+					arc.DeferObject(false);
+				}
+			}
+			arc.EndObject();
+		}
+	}
+	else if (arc.BeginObject(key))
+	{
+		const char *indexkey;
+		while ((indexkey = arc.GetKey()))
+		{
+			unsigned i = (unsigned)strtoull(indexkey, nullptr, 10);
+			if (i < items.Size() && i < pristine.Size())
+			{
+				Serialize(arc, nullptr, items[i], &pristine[i]);
+			}
+		}
+		arc.EndObject();
+	}
+	else
+	{
+		arc(oldkey, items, pristine);
+	}
+}
+
 //==========================================================================
 //
 // RecalculateDrawnSubsectors
@@ -976,10 +1116,10 @@ void FLevelLocals::Serialize(FSerializer &arc, bool hubload)
 	Behaviors.SerializeModuleStates(arc);
 	// The order here is important: First world state, then portal state, then thinkers, and last polyobjects.
 	SetCompatLineOnSide(false);	// This flag should not be saved. It solely depends on current compatibility state.
-	arc("linedefs", lines, loadlines);
+	SerializeLevelChanges(arc, "changedlines", "linedefs", lines, loadlines);
 	SetCompatLineOnSide(true);
-	arc("sidedefs", sides, loadsides);
-	arc("sectors", sectors, loadsectors);
+	SerializeLevelChanges(arc, "changedsides", "sidedefs", sides, loadsides);
+	SerializeLevelChanges(arc, "changedsectors", "sectors", sectors, loadsectors);
 	arc("zones", Zones);
 	arc("lineportals", linePortals);
 	arc("sectorportals", sectorPortals);
@@ -1039,19 +1179,23 @@ void FLevelLocals::Serialize(FSerializer &arc, bool hubload)
 //
 //==========================================================================
 
-void FLevelLocals::SnapshotLevel()
+void FLevelLocals::SnapshotLevel(bool compress)
 {
+	G_WaitForSaveGame();
 	info->Snapshot.Clean();
 
 	if (info->isValid())
 	{
 		FSerializer arc(this);
 
-		if (arc.OpenWriter(save_formatted))
+		if (save_binary ? arc.OpenBinaryWriter() : arc.OpenWriter(save_formatted))
 		{
+			uint64_t start = I_nsTime();
 			SaveVersion = SAVEVER;
 			Serialize(arc, false);
-			info->Snapshot = arc.GetCompressedOutput();
+			info->Snapshot = compress ? arc.GetCompressedOutput() : arc.GetStoredOutput();
+			DPrintf(DMSG_NOTIFY, "Snapshot of %s: %u bytes, %u stored, %.2f ms\n", MapName.GetChars(),
+				info->Snapshot.mSize, info->Snapshot.mCompressedSize, (I_nsTime() - start) / 1e6);
 		}
 	}
 }
@@ -1108,6 +1252,7 @@ void FLevelLocals::UnSnapshotLevel(bool hubLoad)
 		arc.Close();
 	}
 	// No reason to keep the snapshot around once the level's been entered.
+	G_WaitForSaveGame();
 	info->Snapshot.Clean();
 	if (hubLoad)
 	{
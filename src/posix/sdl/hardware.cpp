@@ -60,7 +60,7 @@ void I_ShutdownGraphics ()
 	if (Video)
 		delete Video, Video = NULL;
 
-	SDL_QuitSubSystem (SDL_INIT_VIDEO);
+	SDL_QuitSubSystem (SDL_INIT_VIDEO | SDL_INIT_EVENTS);
 }
 
 void I_InitGraphics ()
@@ -69,17 +69,27 @@ void I_InitGraphics ()
 	SDL_SetHint(SDL_HINT_VIDEO_MAC_FULLSCREEN_SPACES, "0");
 #endif // __APPLE__
 
-	if (SDL_InitSubSystem (SDL_INIT_VIDEO) < 0)
+	extern IVideo *gl_CreateVideo();
+	extern IVideo *null_CreateVideo();
+	if (Args->CheckParm("-nullrenderer"))
 	{
-		I_FatalError ("Could not initialize SDL video:\n%s\n", SDL_GetError());
-		return;
+		// The null backend never opens a window, so it must not depend on a display being available.
+		// Only the event queue is needed for input polling.
+		SDL_InitSubSystem (SDL_INIT_EVENTS);
+		Video = null_CreateVideo();
 	}
+	else
+	{
+		if (SDL_InitSubSystem (SDL_INIT_VIDEO) < 0)
+		{
+			I_FatalError ("Could not initialize SDL video:\n%s\n", SDL_GetError());
+			return;
+		}
 
-	Printf("Using video driver %s\n", SDL_GetCurrentVideoDriver());
+		Printf("Using video driver %s\n", SDL_GetCurrentVideoDriver());
+		Video = gl_CreateVideo();
+	}
 
-	extern IVideo *gl_CreateVideo();
-	Video = gl_CreateVideo();
-	
 	if (Video == NULL)
 		I_FatalError ("Failed to initialize display");
 
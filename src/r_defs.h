@@ -103,6 +103,7 @@ struct vertex_t
 	bool dirty;			// something has changed and needs to be recalculated
 	int numheights;
 	int numsectors;
+	int heightstamp;	// gets incremented each time the height list is recalculated
 	sector_t ** sectors;
 	float * heightlist;
 
@@ -158,7 +159,7 @@ struct vertex_t
 		angletime = 0;
 		viewangle = 0;
 		dirty = true;
-		numheights = numsectors = 0;
+		numheights = numsectors = heightstamp = 0;
 		sectors = NULL;
 		heightlist = NULL;
 	}
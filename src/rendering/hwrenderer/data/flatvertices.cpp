@@ -36,6 +36,8 @@
 #include "hwrenderer/data/buffers.h"
 #include "hwrenderer/scene/hw_renderstate.h"
 
+unsigned int FFlatVertexBuffer::FrameCounter;
+
 //==========================================================================
 //
 //
@@ -89,6 +91,8 @@ FFlatVertexBuffer::FFlatVertexBuffer(int width, int height)
 
 	mIndex = mCurIndex = 0;
 	mNumReserved = NUM_RESERVED;
+	mWallCacheStart = mWallCacheEnd = mWallCacheUsed = mWallCacheMax = mWallCacheWanted = 0;
+	mFrame = ++FrameCounter;
 	Copy(0, NUM_RESERVED);
 }
 
@@ -372,6 +376,47 @@ std::pair<FFlatVertex *, unsigned int> FFlatVertexBuffer::AllocVertices(unsigned
 	return std::make_pair(p, index);
 }
 
+//==========================================================================
+//
+// Reserves persistent storage for a static wall.
+// The wall cache is a simple bump allocator. Once it is full, further
+// walls just go through the per-frame vertex allocation until the cache
+// gets enlarged at the start of the next frame.
+//
+//==========================================================================
+
+bool FFlatVertexBuffer::AllocWallSlot(FWallVertexSlot *slot, unsigned int count)
+{
+	if (slot->capacity >= count) return true;
+	if (slot->capacity > 0) return false;
+	if (mWallCacheUsed + count > mWallCacheEnd)
+	{
+		mWallCacheWanted += count;
+		return false;
+	}
+	slot->index = mWallCacheUsed;
+	slot->capacity = count;
+	mWallCacheUsed += count;
+	return true;
+}
+
+//==========================================================================
+//
+// The wall cache sits between the flats and the per-frame data, so it
+// can only be enlarged while no per-frame data is in use.
+// Grow by at least half the current size so that this does not need to
+// be done again every frame while the player explores the map.
+//
+//==========================================================================
+
+void FFlatVertexBuffer::GrowWallCache()
+{
+	unsigned int grow = std::max(mWallCacheWanted, (mWallCacheEnd - mWallCacheStart) / 2);
+	mWallCacheEnd = std::min(mWallCacheEnd + grow, mWallCacheMax);
+	mIndex = mWallCacheEnd;
+	mWallCacheWanted = 0;
+}
+
 //==========================================================================
 //
 //
@@ -391,11 +436,39 @@ void FFlatVertexBuffer::Copy(int start, int count)
 //
 //==========================================================================
 
-void FFlatVertexBuffer::CreateVBO(TArray<sector_t> &sectors)
+void FFlatVertexBuffer::CreateVBO(TArray<sector_t> &sectors, TArray<seg_t> &segs)
 {
 	vbo_shadowdata.Resize(mNumReserved);
 	FFlatVertexBuffer::CreateVertices(sectors);
-	mCurIndex = mIndex = vbo_shadowdata.Size();
-	Copy(0, mIndex);
+	Copy(0, vbo_shadowdata.Size());
+
+	// Static walls get baked into the space right after the flats when first seen.
+	// The initial size is what the level's textured wall parts need with 4 vertices each,
+	// which is enough for everything that does not need to be split. If that runs out the
+	// cache grows, but never to more than a quarter of the buffer so that the per-frame
+	// data always has enough room.
+	unsigned int cachesize = 0;
+	for (auto &seg : segs)
+	{
+		auto side = seg.sidedef;
+		if (side == nullptr) continue;
+		if (seg.backsector == nullptr) cachesize += 4;
+		else
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				if (side->GetTexture(i).isValid()) cachesize += 4;
+			}
+		}
+	}
+	unsigned int numslots = segs.Size() * NUM_WALLSLOTS;
+	mWallSlots.Resize(numslots);
+	if (numslots > 0) memset(&mWallSlots[0], 0, numslots * sizeof(FWallVertexSlot));
+	mWallCacheStart = mWallCacheUsed = vbo_shadowdata.Size();
+	mWallCacheMax = mWallCacheStart + std::min<unsigned int>(numslots * 4, BUFFER_SIZE / 4);
+	mWallCacheEnd = std::min(mWallCacheStart + cachesize, mWallCacheMax);
+	mWallCacheWanted = 0;
+
+	mCurIndex = mIndex = mWallCacheEnd;
 	mIndexBuffer->SetData(ibo_data.Size() * sizeof(uint32_t), &ibo_data[0]);
 }
@@ -32,6 +32,7 @@
 class FRenderState;
 struct secplane_t;
 struct subsector_t;
+struct seg_t;
 
 struct FFlatVertex
 {
@@ -49,6 +50,35 @@ struct FFlatVertex
 	}
 };
 
+//==========================================================================
+//
+// Persistent vertex storage for one static wall part.
+// The key holds everything the vertex data depends on so that a wall
+// only needs to be regenerated when one of its inputs changes.
+//
+//==========================================================================
+
+struct FWallVertexKey
+{
+	float coords[18];	// seg position, split fractions, z-coordinates and texture coordinates
+	int heightstamp[2];	// vertex height list versions, for seamless splitting
+	int flags;
+
+	bool operator==(const FWallVertexKey &other) const
+	{
+		return !memcmp(this, &other, sizeof(*this));
+	}
+};
+
+struct FWallVertexSlot
+{
+	FWallVertexKey key;
+	unsigned int index;		// start of this slot in the vertex buffer
+	unsigned int capacity;	// number of reserved vertices, 0 if never allocated
+	unsigned int count;		// number of valid vertices, 0 if the slot is invalid
+	unsigned int frame;		// last frame the slot got used in
+};
+
 class FFlatVertexBuffer
 {
 	TArray<FFlatVertex> vbo_shadowdata;
@@ -61,6 +91,15 @@ class FFlatVertexBuffer
 	std::atomic<unsigned int> mCurIndex;
 	unsigned int mNumReserved;
 
+	TArray<FWallVertexSlot> mWallSlots;
+	unsigned int mWallCacheStart;
+	unsigned int mWallCacheEnd;
+	unsigned int mWallCacheUsed;
+	unsigned int mWallCacheMax;
+	unsigned int mWallCacheWanted;	// space that was missing since the last frame started
+	unsigned int mFrame;
+
+	static unsigned int FrameCounter;
 
 	static const unsigned int BUFFER_SIZE = 2000000;
 	static const unsigned int BUFFER_SIZE_TO_USE = 1999500;
@@ -77,6 +116,15 @@ public:
 		NUM_RESERVED = 20
 	};
 
+	enum
+	{
+		WALLSLOT_TOP,
+		WALLSLOT_BOTTOM,
+		WALLSLOT_MID,
+
+		NUM_WALLSLOTS
+	};
+
 	FFlatVertexBuffer(int width, int height);
 	~FFlatVertexBuffer();
 
@@ -86,7 +134,7 @@ public:
 		return std::make_pair(mVertexBuffer, mIndexBuffer);
 	}
 
-	void CreateVBO(TArray<sector_t> &sectors);
+	void CreateVBO(TArray<sector_t> &sectors, TArray<seg_t> &segs);
 	void Copy(int start, int count);
 
 	FFlatVertex *GetBuffer(int index) const
@@ -102,9 +150,27 @@ public:
 
 	std::pair<FFlatVertex *, unsigned int> AllocVertices(unsigned int count);
 
+	FWallVertexSlot *GetWallSlot(unsigned int segnum, int part)
+	{
+		unsigned int i = segnum * NUM_WALLSLOTS + part;
+		return i < mWallSlots.Size() ? &mWallSlots[i] : nullptr;
+	}
+
+	bool AllocWallSlot(FWallVertexSlot *slot, unsigned int count);
+
+	unsigned int GetFrame() const
+	{
+		return mFrame;
+	}
+
+	void GrowWallCache();
+
 	void Reset()
 	{
+		if (mWallCacheWanted > 0) GrowWallCache();
 		mCurIndex = mIndex;
+		// Shared by all instances so that a frame number is never repeated when the renderer gets recreated.
+		mFrame = ++FrameCounter;
 	}
 
 	void Map()
@@ -76,6 +76,33 @@ LevelAABBTree::LevelAABBTree(FLevelLocals *lev)
 		treeline.dx = (float)line.v2->fX() - treeline.x;
 		treeline.dy = (float)line.v2->fY() - treeline.y;
 	}
+
+	// Link up the nodes so that moving lines only need to touch their own path to the root
+	nodeParents.Resize(nodes.Size());
+	dirtyNodes.Resize(nodes.Size());
+	lineLeafs.Resize(treelines.Size());
+	for (unsigned int i = 0; i < nodes.Size(); i++)
+	{
+		nodeParents[i] = -1;
+		dirtyNodes[i] = false;
+	}
+	for (unsigned int i = 0; i < treelines.Size(); i++)
+	{
+		lineLeafs[i] = -1;
+	}
+	for (unsigned int i = 0; i < nodes.Size(); i++)
+	{
+		const auto &node = nodes[i];
+		if (node.line_index != -1)
+		{
+			lineLeafs[node.line_index] = i;
+		}
+		else
+		{
+			if (node.left_node != -1) nodeParents[node.left_node] = i;
+			if (node.right_node != -1) nodeParents[node.right_node] = i;
+		}
+	}
 }
 
 bool LevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubtree)
@@ -115,7 +142,9 @@ bool LevelAABBTree::GenerateTree(const FVector2 *centroids, bool dynamicsubtree)
 
 bool LevelAABBTree::Update()
 {
-	bool modified = false;
+	dirtyStartNode = dirtyStartLine = INT_MAX;
+	dirtyEndNode = dirtyEndLine = 0;
+
 	for (unsigned int i = dynamicStartLine; i < mapLines.Size(); i++)
 	{
 		const auto &line = Level->lines[mapLines[i]];
@@ -126,76 +155,80 @@ bool LevelAABBTree::Update()
 		treeline.dx = (float)line.v2->fX() - treeline.x;
 		treeline.dy = (float)line.v2->fY() - treeline.y;
 
-		if (memcmp(&treelines[i], &treeline, sizeof(AABBTreeLine)))
+		int nodeIndex = lineLeafs[i];
+		if (nodeIndex != -1 && memcmp(&treelines[i], &treeline, sizeof(AABBTreeLine)))
 		{
-			TArray<int> path = FindNodePath(i, nodes.Size() - 1);
-			if (path.Size())
+			float x1 = (float)line.v1->fX();
+			float y1 = (float)line.v1->fY();
+			float x2 = (float)line.v2->fX();
+			float y2 = (float)line.v2->fY();
+
+			nodes[nodeIndex].aabb_left = MIN(x1, x2);
+			nodes[nodeIndex].aabb_right = MAX(x1, x2);
+			nodes[nodeIndex].aabb_top = MIN(y1, y2);
+			nodes[nodeIndex].aabb_bottom = MAX(y1, y2);
+
+			treelines[i] = treeline;
+			dirtyStartLine = MIN(dirtyStartLine, (int)i);
+			dirtyEndLine = MAX(dirtyEndLine, (int)i + 1);
+
+			// Flag the path to the root. If a node already is flagged, so is the rest of the path.
+			dirtyStartNode = MIN(dirtyStartNode, nodeIndex);
+			for (int n = nodeIndex; n != -1 && !dirtyNodes[n]; n = nodeParents[n])
 			{
-				float x1 = (float)line.v1->fX();
-				float y1 = (float)line.v1->fY();
-				float x2 = (float)line.v2->fX();
-				float y2 = (float)line.v2->fY();
-
-				int nodeIndex = path[0];
-				nodes[nodeIndex].aabb_left = MIN(x1, x2);
-				nodes[nodeIndex].aabb_right = MAX(x1, x2);
-				nodes[nodeIndex].aabb_top = MIN(y1, y2);
-				nodes[nodeIndex].aabb_bottom = MAX(y1, y2);
-
-				for (unsigned int j = 1; j < path.Size(); j++)
-				{
-					auto &cur = nodes[path[j]];
-					const auto &left = nodes[cur.left_node];
-					const auto &right = nodes[cur.right_node];
-					cur.aabb_left = MIN(left.aabb_left, right.aabb_left);
-					cur.aabb_top = MIN(left.aabb_top, right.aabb_top);
-					cur.aabb_right = MAX(left.aabb_right, right.aabb_right);
-					cur.aabb_bottom = MAX(left.aabb_bottom, right.aabb_bottom);
-				}
-
-				treelines[i] = treeline;
-				modified = true;
+				dirtyNodes[n] = true;
+				dirtyEndNode = MAX(dirtyEndNode, n + 1);
 			}
 		}
 	}
-	return modified;
-}
-
-TArray<int> LevelAABBTree::FindNodePath(unsigned int line, unsigned int node)
-{
-	const AABBTreeNode &n = nodes[node];
 
-	if (n.aabb_left > treelines[line].x || n.aabb_right < treelines[line].x ||
-		n.aabb_top > treelines[line].y || n.aabb_bottom < treelines[line].y)
+	if (dirtyEndLine == 0)
 	{
-		return {};
+		dirtyStartNode = dirtyStartLine = 0;
+		return false;
 	}
 
-	TArray<int> path;
-	if (n.line_index == -1)
+	// Refit all flagged nodes. Since children are always stored before their parents a single pass suffices.
+	for (int i = dirtyStartNode; i < dirtyEndNode; i++)
 	{
-		path = FindNodePath(line, n.left_node);
-		if (path.Size() == 0)
-			path = FindNodePath(line, n.right_node);
+		if (!dirtyNodes[i])
+			continue;
 
-		if (path.Size())
-			path.Push(node);
-	}
-	else if (n.line_index == (int)line)
-	{
-		path.Push(node);
+		dirtyNodes[i] = false;
+		auto &cur = nodes[i];
+		if (cur.line_index == -1)
+		{
+			const auto &left = nodes[cur.left_node];
+			const auto &right = nodes[cur.right_node];
+			cur.aabb_left = MIN(left.aabb_left, right.aabb_left);
+			cur.aabb_top = MIN(left.aabb_top, right.aabb_top);
+			cur.aabb_right = MAX(left.aabb_right, right.aabb_right);
+			cur.aabb_bottom = MAX(left.aabb_bottom, right.aabb_bottom);
+		}
 	}
-	return path;
+	return true;
 }
 
-double LevelAABBTree::RayTest(const DVector3 &ray_start, const DVector3 &ray_end)
+double LevelAABBTree::RayTest(const DVector3 &ray_start, const DVector3 &ray_end, int *hitline)
 {
+	return FindHit(ray_start, ray_end, false, hitline);
+}
+
+bool LevelAABBTree::RayBlocked(const DVector3 &ray_start, const DVector3 &ray_end)
+{
+	return FindHit(ray_start, ray_end, true, nullptr) < 1.0;
+}
+
+double LevelAABBTree::FindHit(const DVector3 &ray_start, const DVector3 &ray_end, bool stopAtFirstHit, int *hitline)
+{
+	if (hitline) *hitline = -1;
+
 	// Precalculate some of the variables used by the ray/line intersection test
 	DVector2 raydelta = ray_end - ray_start;
 	double raydist2 = raydelta | raydelta;
 	DVector2 raynormal = DVector2(raydelta.Y, -raydelta.X);
 	double rayd = raynormal | ray_start;
-	if (raydist2 < 1.0)
+	if (raydist2 < 1.0 || nodes.Size() == 0)
 		return 1.0f;
 
 	double hit_fraction = 1.0;
@@ -216,7 +249,14 @@ double LevelAABBTree::RayTest(const DVector3 &ray_start, const DVector3 &ray_end
 		else if (nodes[node_index].line_index != -1) // isLeaf(node_index)
 		{
 			// We reached a leaf node. Do a ray/line intersection test to see if we hit the line.
-			hit_fraction = MIN(IntersectRayLine(ray_start, ray_end, nodes[node_index].line_index, raydelta, rayd, raydist2), hit_fraction);
+			int line_index = nodes[node_index].line_index;
+			double fraction = IntersectRayLine(ray_start, ray_end, line_index, raydelta, rayd, raydist2);
+			if (fraction < hit_fraction)
+			{
+				hit_fraction = fraction;
+				if (hitline) *hitline = mapLines[line_index];
+				if (stopAtFirstHit) break;
+			}
 			stack_pos--;
 		}
 		else if (stack_pos == 32)
@@ -235,32 +275,27 @@ double LevelAABBTree::RayTest(const DVector3 &ray_start, const DVector3 &ray_end
 	return hit_fraction;
 }
 
-bool LevelAABBTree::OverlapRayAABB(const DVector2 &ray_start2d, const DVector2 &ray_end2d, const AABBTreeNode &node)
+bool LevelAABBTree::OverlapRayAABB(const DVector2 &ray_start, const DVector2 &ray_end, const AABBTreeNode &node)
 {
-	// To do: simplify test to use a 2D test
-	DVector3 ray_start = DVector3(ray_start2d, 0.0);
-	DVector3 ray_end = DVector3(ray_end2d, 0.0);
-	DVector3 aabb_min = DVector3(node.aabb_left, node.aabb_top, -1.0);
-	DVector3 aabb_max = DVector3(node.aabb_right, node.aabb_bottom, 1.0);
+	// Separating axis test between the ray segment and the box.
+	// This is the 2D reduction of the standard 3D ray/AABB overlap test from Real-Time Rendering, 3rd Edition.
+	// With the ray at z=0 and the box spanning z=-1 to 1 all tests involving the z axis can never separate.
 
-	// Standard 3D ray/AABB overlapping test.
-	// The details for the math here can be found in Real-Time Rendering, 3rd Edition.
-	// We could use a 2D test here instead, which would probably simplify the math.
+	DVector2 aabb_min = DVector2(node.aabb_left, node.aabb_top);
+	DVector2 aabb_max = DVector2(node.aabb_right, node.aabb_bottom);
 
-	DVector3 c = (ray_start + ray_end) * 0.5f;
-	DVector3 w = ray_end - c;
-	DVector3 h = (aabb_max - aabb_min) * 0.5f; // aabb.extents();
+	DVector2 c = (ray_start + ray_end) * 0.5f;
+	DVector2 w = ray_end - c;
+	DVector2 h = (aabb_max - aabb_min) * 0.5f; // aabb.extents();
 
 	c -= (aabb_max + aabb_min) * 0.5f; // aabb.center();
 
-	DVector3 v = DVector3(fabs(w.X), fabs(w.Y), fabs(w.Z));
+	DVector2 v = DVector2(fabs(w.X), fabs(w.Y));
 
-	if (fabs(c.X) > v.X + h.X || fabs(c.Y) > v.Y + h.Y || fabs(c.Z) > v.Z + h.Z)
+	if (fabs(c.X) > v.X + h.X || fabs(c.Y) > v.Y + h.Y)
 		return false; // disjoint;
 
-	if (fabs(c.Y * w.Z - c.Z * w.Y) > h.Y * v.Z + h.Z * v.Y ||
-		fabs(c.X * w.Z - c.Z * w.X) > h.X * v.Z + h.Z * v.X ||
-		fabs(c.X * w.Y - c.Y * w.X) > h.X * v.Y + h.Y * v.X)
+	if (fabs(c.X * w.Y - c.Y * w.X) > h.X * v.Y + h.Y * v.X)
 		return false; // disjoint;
 
 	return true; // overlap;
@@ -45,8 +45,13 @@ public:
 	LevelAABBTree(FLevelLocals *lev);
 
 	// Shoot a ray from ray_start to ray_end and return the closest hit as a fractional value between 0 and 1. Returns 1 if no line was hit.
-	double RayTest(const DVector3 &ray_start, const DVector3 &ray_end);
+	// If hitline is given it receives the index into Level->lines of the line that was hit, or -1.
+	double RayTest(const DVector3 &ray_start, const DVector3 &ray_end, int *hitline = nullptr);
 
+	// Returns true if any line is between ray_start and ray_end. Faster than RayTest because it stops at the first hit.
+	bool RayBlocked(const DVector3 &ray_start, const DVector3 &ray_end);
+
+	// Refits the nodes above all polyobject lines that moved. Returns true if anything changed.
 	bool Update();
 
 	const void *Nodes() const { return nodes.Data(); }
@@ -55,16 +60,20 @@ public:
 	size_t LinesSize() const { return treelines.Size() * sizeof(AABBTreeLine); }
 	unsigned int NodesCount() const { return nodes.Size(); }
 
-	const void *DynamicNodes() const { return nodes.Data() + dynamicStartNode; }
-	const void *DynamicLines() const { return treelines.Data() + dynamicStartLine; }
-	size_t DynamicNodesSize() const { return (nodes.Size() - dynamicStartNode) * sizeof(AABBTreeNode); }
-	size_t DynamicLinesSize() const { return (treelines.Size() - dynamicStartLine) * sizeof(AABBTreeLine); }
-	size_t DynamicNodesOffset() const { return dynamicStartNode * sizeof(AABBTreeNode); }
-	size_t DynamicLinesOffset() const { return dynamicStartLine * sizeof(AABBTreeLine); }
+	// The range of nodes and lines changed by the last Update() call
+	const void *DirtyNodes() const { return nodes.Data() + dirtyStartNode; }
+	const void *DirtyLines() const { return treelines.Data() + dirtyStartLine; }
+	size_t DirtyNodesSize() const { return (dirtyEndNode - dirtyStartNode) * sizeof(AABBTreeNode); }
+	size_t DirtyLinesSize() const { return (dirtyEndLine - dirtyStartLine) * sizeof(AABBTreeLine); }
+	size_t DirtyNodesOffset() const { return dirtyStartNode * sizeof(AABBTreeNode); }
+	size_t DirtyLinesOffset() const { return dirtyStartLine * sizeof(AABBTreeLine); }
 
 private:
 	bool GenerateTree(const FVector2 *centroids, bool dynamicsubtree);
 
+	// Walk the tree and return the closest hit, or the first one if stopAtFirstHit is set
+	double FindHit(const DVector3 &ray_start, const DVector3 &ray_end, bool stopAtFirstHit, int *hitline);
+
 	// Test if a ray overlaps an AABB node or not
 	bool OverlapRayAABB(const DVector2 &ray_start2d, const DVector2 &ray_end2d, const AABBTreeNode &node);
 
@@ -74,17 +83,26 @@ private:
 	// Generate a tree node and its children recursively
 	int GenerateTreeNode(int *treelines, int num_lines, const FVector2 *centroids, int *work_buffer);
 
-	TArray<int> FindNodePath(unsigned int line, unsigned int node);
-
 	// Nodes in the AABB tree. Last node is the root node.
 	TArray<AABBTreeNode> nodes;
 
 	// Line segments for the leaf nodes in the tree.
 	TArray<AABBTreeLine> treelines;
 
+	// Parent of each node and leaf node of each line, so that Update can refit the tree bottom up.
+	// Children are always stored before their parents.
+	TArray<int> nodeParents;
+	TArray<int> lineLeafs;
+	TArray<uint8_t> dirtyNodes;
+
 	int dynamicStartNode = 0;
 	int dynamicStartLine = 0;
 
+	int dirtyStartNode = 0;
+	int dirtyEndNode = 0;
+	int dirtyStartLine = 0;
+	int dirtyEndLine = 0;
+
 	TArray<int> mapLines;
 	FLevelLocals *Level;
 };
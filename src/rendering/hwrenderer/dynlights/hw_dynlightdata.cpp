@@ -68,14 +68,15 @@ bool FDynLightData::GetLight(int group, Plane & p, FDynamicLight * light, bool c
 
 //==========================================================================
 //
-// Add one dynamic light to the light data list
+// Packs the shader data for one light into 16 floats and returns
+// which of the three light lists it belongs to.
+// The position is left in the light's own portal group.
 //
 //==========================================================================
-void FDynLightData::AddLightToList(int group, FDynamicLight * light, bool forceAttenuate)
+int FDynLightData::PackLight(FDynamicLight *light, float *data)
 {
 	int i = 0;
 
-	DVector3 pos = light->PosRelative(group);
 	float radius = light->GetRadius();
 
 	float cs;
@@ -104,11 +105,6 @@ void FDynLightData::AddLightToList(int group, FDynamicLight * light, bool forceA
 		i = 1;
 	}
 
-	float shadowIndex = light->mShadowmapIndex + 1.0f;
-
-    // Store attenuate flag in the sign bit of the float.
-	if (light->IsAttenuated() || forceAttenuate) shadowIndex = -shadowIndex;
-
 	float lightType = 0.0f;
 	float spotInnerAngle = 0.0f;
 	float spotOuterAngle = 0.0f;
@@ -129,15 +125,14 @@ void FDynLightData::AddLightToList(int group, FDynamicLight * light, bool forceA
 		spotDirZ = float(-Angle.Sin() * xzLen);
 	}
 
-	float *data = &arrays[i][arrays[i].Reserve(16)];
-	data[0] = float(pos.X);
-	data[1] = float(pos.Z);
-	data[2] = float(pos.Y);
+	data[0] = float(light->Pos.X);
+	data[1] = float(light->Pos.Z);
+	data[2] = float(light->Pos.Y);
 	data[3] = radius;
 	data[4] = r;
 	data[5] = g;
 	data[6] = b;
-	data[7] = shadowIndex;
+	data[7] = 0.0f; // filled in by AddLightToList
 	data[8] = spotDirX;
 	data[9] = spotDirY;
 	data[10] = spotDirZ;
@@ -146,5 +141,78 @@ void FDynLightData::AddLightToList(int group, FDynamicLight * light, bool forceA
 	data[13] = spotOuterAngle;
 	data[14] = 0.0f; // unused
 	data[15] = 0.0f; // unused
+	return i;
+}
+
+//==========================================================================
+//
+// Packs all active lights of a level once per frame, before the scene
+// gets processed. A light touching many surfaces will then only have
+// its data copied for each of them instead of being recalculated.
+// All light properties only change during the playsim's tick so this
+// remains valid for all views rendered in the same frame.
+// The frame number comes from the vertex buffer whose counter never
+// starts over, so records from before a renderer restart cannot be
+// mistaken for current ones. It starts at 1 and newly spawned lights
+// are zeroed, so they never match.
+//
+// This takes the place of a clustered light grid: the light shaders
+// walk a per-surface light range instead of looking lights up per
+// cluster, so binning lights into a froxel grid would not reduce
+// any shader work.
+//
+//==========================================================================
+static unsigned lightrecordframe;
+
+void FDynLightData::PrepareLights(FLevelLocals *Level, unsigned frame)
+{
+	lightrecordframe = frame;
+	for (auto light = Level->lights; light; light = light->next)
+	{
+		// New lights only get added between frames and always at the head of the list.
+		if (light->mRecordFrame == frame) break;
+		if (light->IsActive())
+		{
+			light->mRecordList = PackLight(light, light->mRecord);
+			light->mRecordFrame = frame;
+		}
+	}
 }
 
+//==========================================================================
+//
+// Add one dynamic light to the light data list
+//
+//==========================================================================
+void FDynLightData::AddLightToList(int group, FDynamicLight * light, bool forceAttenuate)
+{
+	float *data;
+	if (light->mRecordFrame == lightrecordframe)
+	{
+		data = &arrays[light->mRecordList][arrays[light->mRecordList].Reserve(16)];
+		memcpy(data, light->mRecord, sizeof(light->mRecord));
+	}
+	else
+	{
+		// Not prepared for this frame, e.g. a light from a level that isn't being rendered right now.
+		float record[16];
+		int i = PackLight(light, record);
+		data = &arrays[i][arrays[i].Reserve(16)];
+		memcpy(data, record, sizeof(record));
+	}
+
+	if (group != light->Sector->PortalGroup)
+	{
+		DVector3 pos = light->PosRelative(group);
+		data[0] = float(pos.X);
+		data[1] = float(pos.Z);
+		data[2] = float(pos.Y);
+	}
+
+	// The shadow map index can change between views of the same frame so it must not be taken from the cached data.
+	float shadowIndex = light->mShadowmapIndex + 1.0f;
+
+	// Store attenuate flag in the sign bit of the float.
+	if (light->IsAttenuated() || forceAttenuate) shadowIndex = -shadowIndex;
+	data[7] = shadowIndex;
+}
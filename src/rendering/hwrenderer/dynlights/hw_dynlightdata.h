@@ -56,6 +56,11 @@ struct FDynLightData
     bool GetLight(int group, Plane & p, FDynamicLight * light, bool checkside);
     void AddLightToList(int group, FDynamicLight * light, bool forceAttenuate);
 
+	static void PrepareLights(FLevelLocals *Level, unsigned frame);
+
+private:
+	static int PackLight(FDynamicLight *light, float *data);
+
 };
 
 extern thread_local FDynLightData lightdata;
@@ -99,7 +99,7 @@ CUSTOM_CVAR (Bool, gl_light_shadowmap, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
 bool IShadowMap::ShadowTest(FDynamicLight *light, const DVector3 &pos)
 {
 	if (light->shadowmapped && light->GetRadius() > 0.0 && IsEnabled() && mAABBTree)
-		return mAABBTree->RayTest(light->Pos, pos) >= 1.0f;
+		return !mAABBTree->RayBlocked(light->Pos, pos);
 	else
 		return true;
 }
@@ -209,8 +209,8 @@ void IShadowMap::UploadAABBTree()
 	}
 	else if (mAABBTree->Update())
 	{
-		mNodesBuffer->SetSubData(mAABBTree->DynamicNodesOffset(), mAABBTree->DynamicNodesSize(), mAABBTree->DynamicNodes());
-		mLinesBuffer->SetSubData(mAABBTree->DynamicLinesOffset(), mAABBTree->DynamicLinesSize(), mAABBTree->DynamicLines());
+		mNodesBuffer->SetSubData(mAABBTree->DirtyNodesOffset(), mAABBTree->DirtyNodesSize(), mAABBTree->DirtyNodes());
+		mLinesBuffer->SetSubData(mAABBTree->DirtyLinesOffset(), mAABBTree->DirtyLinesSize(), mAABBTree->DirtyLines());
 	}
 }
 
@@ -41,6 +41,7 @@
 #include "hwrenderer/data/hw_viewpointbuffer.h"
 #include "hwrenderer/data/flatvertices.h"
 #include "hwrenderer/dynlights/hw_lightbuffer.h"
+#include "hwrenderer/dynlights/hw_dynlightdata.h"
 #include "hwrenderer/utility/hw_vrmodes.h"
 #include "hw_clipper.h"
 
@@ -436,6 +437,8 @@ void HWDrawInfo::CreateScene(bool drawpsprites)
 	screen->mVertexData->Map();
 	screen->mLights->Map();
 
+	if (Level->HasDynamicLights) FDynLightData::PrepareLights(Level, screen->mVertexData->GetFrame());
+
 	RenderBSP(Level->HeadNode(), drawpsprites);
 
 	// And now the crappy hacks that have to be done to avoid rendering anomalies.
@@ -37,9 +37,14 @@
 #include "hw_renderstate.h"
 #include "hw_drawinfo.h"
 #include "hw_fakeflat.h"
+#include "parallel_for.h"
 
 FMemArena RenderDataAllocator(1024*1024);	// Use large blocks to reduce allocation time.
 
+// Lists with at least this many items get classified against their splitter on multiple threads.
+static const unsigned MinParallelSortItems = 4096;
+static const int SortSliceSize = 1024;
+
 void ResetRenderDataAllocator()
 {
 	RenderDataAllocator.FreeAll();
@@ -188,46 +193,44 @@ void HWDrawList::MakeSortList()
 
 //==========================================================================
 //
-//
+// Finds the first flat in the list. If there is none, this has scanned
+// the entire list anyway, so it also collects the distance range of the
+// walls for FindSortWall in the same pass. Lists that only contain sprites
+// are detected here and can go straight to SortSpriteList.
 //
 //==========================================================================
-SortNode * HWDrawList::FindSortPlane(SortNode * head)
+SortNode * HWDrawList::FindSortPlane(SortNode * head, float &nearest, float &farthest)
 {
-	while (head->next && drawitems[head->itemindex].rendertype!=DrawType_FLAT) 
-		head=head->next;
-	if (drawitems[head->itemindex].rendertype==DrawType_FLAT) return head;
+	farthest = -FLT_MAX;
+	nearest = FLT_MAX;
+	for (SortNode * node = head; node; node = node->next)
+	{
+		HWDrawItem * it = &drawitems[node->itemindex];
+		if (it->rendertype == DrawType_FLAT) return node;
+		if (it->rendertype == DrawType_WALL)
+		{
+			float d = walls[it->index]->ViewDistance;
+			if (d > farthest) farthest = d;
+			if (d < nearest) nearest = d;
+		}
+	}
 	return NULL;
 }
 
 
 //==========================================================================
 //
-//
+// Picks the wall closest to the middle of the given distance range.
 //
 //==========================================================================
-SortNode * HWDrawList::FindSortWall(SortNode * head)
+SortNode * HWDrawList::FindSortWall(SortNode * head, float nearest, float farthest)
 {
-	float farthest = -FLT_MAX;
-	float nearest = FLT_MAX;
 	SortNode * best = NULL;
-	SortNode * node = head;
 	float bestdist = FLT_MAX;
 
-	while (node)
-	{
-		HWDrawItem * it = &drawitems[node->itemindex];
-		if (it->rendertype == DrawType_WALL)
-		{
-			float d = walls[it->index]->ViewDistance;
-			if (d > farthest) farthest = d;
-			if (d < nearest) nearest = d;
-		}
-		node = node->next;
-	}
-	if (farthest == INT_MIN) return NULL;
-	node = head;
+	if (farthest < nearest) return NULL;	// no walls in this list
 	farthest = (farthest + nearest) / 2;
-	while (node)
+	for (SortNode * node = head; node; node = node->next)
 	{
 		HWDrawItem * it = &drawitems[node->itemindex];
 		if (it->rendertype == DrawType_WALL)
@@ -239,7 +242,6 @@ SortNode * HWDrawList::FindSortWall(SortNode * head)
 				bestdist = di;
 			}
 		}
-		node = node->next;
 	}
 	return best;
 }
@@ -249,17 +251,53 @@ SortNode * HWDrawList::FindSortWall(SortNode * head)
 // Note: sloped planes are a huge problem...
 //
 //==========================================================================
-void HWDrawList::SortPlaneIntoPlane(SortNode * head,SortNode * sort)
+int HWDrawList::ClassifyIntoPlane(SortNode * head, SortNode * sort) const
 {
-	HWFlat * fh= flats[drawitems[head->itemindex].index];
-	HWFlat * fs= flats[drawitems[sort->itemindex].index];
+	HWFlat * fh = flats[drawitems[head->itemindex].index];
+	auto &item = drawitems[sort->itemindex];
+	bool ceiling = fh->z > SortZ;
 
-	if (fh->z==fs->z) 
-		head->AddToEqual(sort);
-	else if ( (fh->z<fs->z && fh->ceiling) || (fh->z>fs->z && !fh->ceiling)) 
-		head->AddToLeft(sort);
-	else 
-		head->AddToRight(sort);
+	switch (item.rendertype)
+	{
+	case DrawType_FLAT:
+	{
+		HWFlat * fs = flats[item.index];
+		if (fh->z == fs->z) return SORT_Equal;
+		else if ((fh->z < fs->z && fh->ceiling) || (fh->z > fs->z && !fh->ceiling)) return SORT_Left;
+		else return SORT_Right;
+	}
+
+	case DrawType_WALL:
+	{
+		HWWall * ws = walls[item.index];
+		if ((ws->ztop[0] > fh->z || ws->ztop[1] > fh->z) && (ws->zbottom[0] < fh->z || ws->zbottom[1] < fh->z)) return SORT_Split;
+		else if ((ws->zbottom[0] < fh->z && !ceiling) || (ws->ztop[0] > fh->z && ceiling)) return SORT_Left;	// completely on the left side
+		else return SORT_Right;
+	}
+
+	case DrawType_SPRITE:
+	{
+		HWSprite * ss = sprites[item.index];
+		auto hiz = ss->z1 > ss->z2 ? ss->z1 : ss->z2;
+		auto loz = ss->z1 < ss->z2 ? ss->z1 : ss->z2;
+		if ((hiz > fh->z && loz < fh->z) || ss->modelframe) return SORT_Split;
+		else if ((ss->z2 < fh->z && !ceiling) || (ss->z1 > fh->z && ceiling)) return SORT_Left;	// completely on the left side
+		else return SORT_Right;
+	}
+	}
+	return SORT_Right;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+void HWDrawList::LinkSorted(SortNode * head, SortNode * sort, int side)
+{
+	if (side == SORT_Equal) head->AddToEqual(sort);
+	else if (side == SORT_Left) head->AddToLeft(sort);
+	else head->AddToRight(sort);
 }
 
 
@@ -268,14 +306,14 @@ void HWDrawList::SortPlaneIntoPlane(SortNode * head,SortNode * sort)
 //
 //
 //==========================================================================
-void HWDrawList::SortWallIntoPlane(SortNode * head, SortNode * sort)
+void HWDrawList::SortWallIntoPlane(SortNode * head, SortNode * sort, int side)
 {
 	HWFlat * fh = flats[drawitems[head->itemindex].index];
 	HWWall * ws = walls[drawitems[sort->itemindex].index];
 
 	bool ceiling = fh->z > SortZ;
 
-	if ((ws->ztop[0] > fh->z || ws->ztop[1] > fh->z) && (ws->zbottom[0] < fh->z || ws->zbottom[1] < fh->z))
+	if (side == SORT_Split)
 	{
 		// We have to split this wall!
 
@@ -310,15 +348,10 @@ void HWDrawList::SortWallIntoPlane(SortNode * head, SortNode * sort)
 		head->AddToLeft(sort);
 		head->AddToRight(sort2);
 	}
-	else if ((ws->zbottom[0] < fh->z && !ceiling) || (ws->ztop[0] > fh->z && ceiling))	// completely on the left side
-	{
-		head->AddToLeft(sort);
-	}
 	else
 	{
-		head->AddToRight(sort);
+		LinkSorted(head, sort, side);
 	}
-
 }
 
 //==========================================================================
@@ -326,17 +359,14 @@ void HWDrawList::SortWallIntoPlane(SortNode * head, SortNode * sort)
 //
 //
 //==========================================================================
-void HWDrawList::SortSpriteIntoPlane(SortNode * head, SortNode * sort)
+void HWDrawList::SortSpriteIntoPlane(SortNode * head, SortNode * sort, int side)
 {
 	HWFlat * fh = flats[drawitems[head->itemindex].index];
 	HWSprite * ss = sprites[drawitems[sort->itemindex].index];
 
 	bool ceiling = fh->z > SortZ;
 
-	auto hiz = ss->z1 > ss->z2 ? ss->z1 : ss->z2;
-	auto loz = ss->z1 < ss->z2 ? ss->z1 : ss->z2;
-
-	if ((hiz > fh->z && loz < fh->z) || ss->modelframe)
+	if (side == SORT_Split)
 	{
 		// We have to split this sprite
 		HWSprite *s = NewSprite();
@@ -367,13 +397,9 @@ void HWDrawList::SortSpriteIntoPlane(SortNode * head, SortNode * sort)
 		head->AddToLeft(sort);
 		head->AddToRight(sort2);
 	}
-	else if ((ss->z2<fh->z && !ceiling) || (ss->z1>fh->z && ceiling))	// completely on the left side
-	{
-		head->AddToLeft(sort);
-	}
 	else
 	{
-		head->AddToRight(sort);
+		LinkSorted(head, sort, side);
 	}
 }
 
@@ -394,38 +420,68 @@ inline double CalcIntersectionVertex(HWWall *w1, HWWall * w2)
 	return ((ay - cy)*(dx - cx) - (ax - cx)*(dy - cy)) / ((bx - ax)*(dy - cy) - (by - ay)*(dx - cx));
 }
 
-void HWDrawList::SortWallIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort)
+//==========================================================================
+//
+// Flats never get sorted into a wall because the wall is only used as
+// splitter if the list contains no flats.
+//
+//==========================================================================
+
+int HWDrawList::ClassifyIntoWall(SortNode * head, SortNode * sort) const
 {
-	HWWall * wh= walls[drawitems[head->itemindex].index];
-	HWWall * ws= walls[drawitems[sort->itemindex].index];
-	float v1=wh->PointOnSide(ws->glseg.x1,ws->glseg.y1);
-	float v2=wh->PointOnSide(ws->glseg.x2,ws->glseg.y2);
+	HWWall * wh = walls[drawitems[head->itemindex].index];
+	auto &item = drawitems[sort->itemindex];
+	float v1, v2;
 
-	if (fabs(v1)<MIN_EQ && fabs(v2)<MIN_EQ) 
+	if (item.rendertype == DrawType_WALL)
 	{
-		if (ws->type==RENDERWALL_FOGBOUNDARY && wh->type!=RENDERWALL_FOGBOUNDARY) 
-		{
-			head->AddToRight(sort);
-		}
-		else if (ws->type!=RENDERWALL_FOGBOUNDARY && wh->type==RENDERWALL_FOGBOUNDARY) 
-		{
-			head->AddToLeft(sort);
-		}
-		else 
+		HWWall * ws = walls[item.index];
+		v1 = wh->PointOnSide(ws->glseg.x1, ws->glseg.y1);
+		v2 = wh->PointOnSide(ws->glseg.x2, ws->glseg.y2);
+
+		if (fabs(v1) < MIN_EQ && fabs(v2) < MIN_EQ)
 		{
-			head->AddToEqual(sort);
+			if (ws->type == RENDERWALL_FOGBOUNDARY && wh->type != RENDERWALL_FOGBOUNDARY) return SORT_Right;
+			else if (ws->type != RENDERWALL_FOGBOUNDARY && wh->type == RENDERWALL_FOGBOUNDARY) return SORT_Left;
+			else return SORT_Equal;
 		}
 	}
-	else if (v1<MIN_EQ && v2<MIN_EQ) 
+	else if (item.rendertype == DrawType_SPRITE)
 	{
-		head->AddToLeft(sort);
+		HWSprite * ss = sprites[item.index];
+		v1 = wh->PointOnSide(ss->x1, ss->y1);
+		v2 = wh->PointOnSide(ss->x2, ss->y2);
+
+		if (fabs(v1) < MIN_EQ && fabs(v2) < MIN_EQ)
+		{
+			return wh->type == RENDERWALL_FOGBOUNDARY ? SORT_Left : SORT_Equal;
+		}
 	}
-	else if (v1>-MIN_EQ && v2>-MIN_EQ) 
+	else return SORT_None;
+
+	if (v1 < MIN_EQ && v2 < MIN_EQ) return SORT_Left;
+	else if (v1 > -MIN_EQ && v2 > -MIN_EQ) return SORT_Right;
+	else return SORT_Split;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void HWDrawList::SortWallIntoWall(HWDrawInfo *di, SortNode * head, SortNode * sort, int side)
+{
+	HWWall * wh= walls[drawitems[head->itemindex].index];
+	HWWall * ws= walls[drawitems[sort->itemindex].index];
+
+	if (side != SORT_Split)
 	{
-		head->AddToRight(sort);
+		LinkSorted(head, sort, side);
 	}
 	else
 	{
+		float v1=wh->PointOnSide(ws->glseg.x1,ws->glseg.y1);
 		double r = CalcIntersectionVertex(ws, wh);
 
 		float ix=(float)(ws->glseg.x1+r*(ws->glseg.x2-ws->glseg.x1));
@@ -483,35 +539,18 @@ inline double CalcIntersectionVertex(HWSprite *s, HWWall * w2)
 	return ((ay - cy)*(dx - cx) - (ax - cx)*(dy - cy)) / ((bx - ax)*(dy - cy) - (by - ay)*(dx - cx));
 }
 
-void HWDrawList::SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort)
+void HWDrawList::SortSpriteIntoWall(HWDrawInfo *di, SortNode * head, SortNode * sort, int side)
 {
 	HWWall *wh= walls[drawitems[head->itemindex].index];
 	HWSprite * ss= sprites[drawitems[sort->itemindex].index];
 
-	float v1 = wh->PointOnSide(ss->x1, ss->y1);
-	float v2 = wh->PointOnSide(ss->x2, ss->y2);
-
-	if (fabs(v1)<MIN_EQ && fabs(v2)<MIN_EQ) 
-	{
-		if (wh->type==RENDERWALL_FOGBOUNDARY) 
-		{
-			head->AddToLeft(sort);
-		}
-		else 
-		{
-			head->AddToEqual(sort);
-		}
-	}
-	else if (v1<MIN_EQ && v2<MIN_EQ) 
-	{
-		head->AddToLeft(sort);
-	}
-	else if (v1>-MIN_EQ && v2>-MIN_EQ) 
+	if (side != SORT_Split)
 	{
-		head->AddToRight(sort);
+		LinkSorted(head, sort, side);
 	}
 	else
 	{
+		float v1 = wh->PointOnSide(ss->x1, ss->y1);
 		const bool drawWithXYBillboard = ((ss->particle && gl_billboard_particles) || (!(ss->actor && ss->actor->renderflags & RF_FORCEYBILLBOARD)
 			&& (gl_billboard_mode == 1 || (ss->actor && ss->actor->renderflags & RF_FORCEXYBILLBOARD))));
 
@@ -576,113 +615,162 @@ void HWDrawList::SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * s
 
 //==========================================================================
 //
-//
+// Sprites are sorted back to front by depth and then by creation order,
+// which gets reversed by COMPATF_SPRITESORT.
+// The sort keys get copied out of the sprites first so that the
+// comparisons do not have to chase 3 pointers for each item.
 //
 //==========================================================================
 
-inline int HWDrawList::CompareSprites(SortNode * a,SortNode * b)
+struct SpriteSortKey
 {
-	HWSprite * s1= sprites[drawitems[a->itemindex].index];
-	HWSprite * s2= sprites[drawitems[b->itemindex].index];
-
-	int res = s1->depth - s2->depth;
-
-	if (res != 0) return -res;
-	else return reverseSort? s2->index-s1->index : s1->index-s2->index;
-}
+	int depth;
+	int index;
+	SortNode *node;
+};
 
-//==========================================================================
-//
-//
-//
-//==========================================================================
 SortNode * HWDrawList::SortSpriteList(SortNode * head)
 {
 	SortNode * n;
-	int count;
 	unsigned i;
 
-	static TArray<SortNode*> sortspritelist;
+	static TArray<SpriteSortKey> sortspritelist;
 
 	SortNode * parent=head->parent;
+	int indexsign = reverseSort ? -1 : 1;
 
 	sortspritelist.Clear();
-	for(count=0,n=head;n;n=n->next) sortspritelist.Push(n);
-	std::stable_sort(sortspritelist.begin(), sortspritelist.end(), [=](SortNode *a, SortNode *b)
+	for(n=head;n;n=n->next)
 	{
-		return CompareSprites(a, b) < 0;
+		HWSprite * s = sprites[drawitems[n->itemindex].index];
+		sortspritelist.Push({ s->depth, s->index * indexsign, n });
+	}
+	std::stable_sort(sortspritelist.begin(), sortspritelist.end(), [](const SpriteSortKey &a, const SpriteSortKey &b)
+	{
+		if (a.depth != b.depth) return a.depth > b.depth;
+		return a.index < b.index;
 	});
 
 	for(i=0;i<sortspritelist.Size();i++)
 	{
-		sortspritelist[i]->next=NULL;
-		if (parent) parent->equal=sortspritelist[i];
-		parent=sortspritelist[i];
+		auto node = sortspritelist[i].node;
+		node->next=NULL;
+		if (parent) parent->equal=node;
+		parent=node;
+	}
+
+#ifdef _DEBUG
+	// Check against the sprites themselves, in the way the order was defined before the keys were introduced.
+	for (i = 1; i < sortspritelist.Size(); i++)
+	{
+		HWSprite * s1 = sprites[drawitems[sortspritelist[i - 1].node->itemindex].index];
+		HWSprite * s2 = sprites[drawitems[sortspritelist[i].node->itemindex].index];
+		assert(s1->depth > s2->depth || (s1->depth == s2->depth && (reverseSort ? s1->index >= s2->index : s1->index <= s2->index)));
 	}
-	return sortspritelist[0];
+#endif
+	return sortspritelist[0].node;
 }
 
 //==========================================================================
 //
+// Determines on which side of the splitter each item of the list ends up.
+// This does not change anything so for long lists it gets spread across
+// threads. Only the items that need to be split are left for the
+// sequential part in DoSort.
+//
+//==========================================================================
+
+static TArray<SortNode*> SortChain;
+static TArray<uint8_t> SortSides;
+
+void HWDrawList::ClassifyList(SortNode * head, SortNode * list, bool plane)
+{
+	SortChain.Clear();
+	for (SortNode * node = list; node; node = node->next) SortChain.Push(node);
+	SortSides.Resize(SortChain.Size());
+
+	const int count = (int)SortChain.Size();
+	auto classify = [=](int start)
+	{
+		const int end = MIN(start + SortSliceSize, count);
+		for (int i = start; i < end; i++)
+		{
+			SortSides[i] = uint8_t(plane ? ClassifyIntoPlane(head, SortChain[i]) : ClassifyIntoWall(head, SortChain[i]));
+		}
+	};
+
+	if (SortChain.Size() >= MinParallelSortItems)
+	{
+		parallel_for(count, SortSliceSize, classify);
+	}
+	else
+	{
+		for (int i = 0; i < count; i += SortSliceSize) classify(i);
+	}
+}
+
+//==========================================================================
 //
+// The items are linked into the tree in their original order so that the
+// result is the same as when sorting them one by one.
 //
 //==========================================================================
 SortNode * HWDrawList::DoSort(HWDrawInfo *di, SortNode * head)
 {
-	SortNode * node, * sn, * next;
+	SortNode * sn;
+	float nearest, farthest;
+	unsigned i;
 
-	sn=FindSortPlane(head);
+	sn=FindSortPlane(head, nearest, farthest);
 	if (sn)
 	{
 		if (sn==head) head=head->next;
 		sn->UnlinkFromChain();
-		node=head;
+		ClassifyList(sn, head, true);
 		head=sn;
-		while (node)
+		for (i = 0; i < SortChain.Size(); i++)
 		{
-			next=node->next;
+			SortNode * node = SortChain[i];
 			switch(drawitems[node->itemindex].rendertype)
 			{
 			case DrawType_FLAT:
-				SortPlaneIntoPlane(head,node);
+				LinkSorted(head, node, SortSides[i]);
 				break;
 
 			case DrawType_WALL:
-				SortWallIntoPlane(head,node);
+				SortWallIntoPlane(head, node, SortSides[i]);
 				break;
 
 			case DrawType_SPRITE:
-				SortSpriteIntoPlane(head,node);
+				SortSpriteIntoPlane(head, node, SortSides[i]);
 				break;
 			}
-			node=next;
 		}
 	}
 	else
 	{
-		sn=FindSortWall(head);
+		sn=FindSortWall(head, nearest, farthest);
 		if (sn)
 		{
 			if (sn==head) head=head->next;
 			sn->UnlinkFromChain();
-			node=head;
+			ClassifyList(sn, head, false);
 			head=sn;
-			while (node)
+			for (i = 0; i < SortChain.Size(); i++)
 			{
-				next=node->next;
+				SortNode * node = SortChain[i];
 				switch(drawitems[node->itemindex].rendertype)
 				{
 				case DrawType_WALL:
-					SortWallIntoWall(di, head,node);
+					SortWallIntoWall(di, head, node, SortSides[i]);
 					break;
 
 				case DrawType_SPRITE:
-					SortSpriteIntoWall(di, head, node);
+					SortSpriteIntoWall(di, head, node, SortSides[i]);
 					break;
 
 				case DrawType_FLAT: break;
 				}
-				node=next;
 			}
 		}
 		else 
@@ -690,6 +778,7 @@ SortNode * HWDrawList::DoSort(HWDrawInfo *di, SortNode * head)
 			return SortSpriteList(head);
 		}
 	}
+	// SortChain gets reused by the recursion so it must not be accessed after this.
 	if (head->left) head->left=DoSort(di, head->left);
 	if (head->right) head->right=DoSort(di, head->right);
 	return sn;
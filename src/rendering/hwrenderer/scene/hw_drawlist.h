@@ -95,15 +95,27 @@ public:
 	void SortFlats();
 	
 	
+	// Where an item goes relative to the splitter
+	enum
+	{
+		SORT_Left,
+		SORT_Right,
+		SORT_Equal,
+		SORT_Split,
+		SORT_None
+	};
+
 	void MakeSortList();
-	SortNode * FindSortPlane(SortNode * head);
-	SortNode * FindSortWall(SortNode * head);
-	void SortPlaneIntoPlane(SortNode * head,SortNode * sort);
-	void SortWallIntoPlane(SortNode * head,SortNode * sort);
-	void SortSpriteIntoPlane(SortNode * head,SortNode * sort);
-	void SortWallIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort);
-	void SortSpriteIntoWall(HWDrawInfo *di, SortNode * head,SortNode * sort);
-	int CompareSprites(SortNode * a,SortNode * b);
+	SortNode * FindSortPlane(SortNode * head, float &nearest, float &farthest);
+	SortNode * FindSortWall(SortNode * head, float nearest, float farthest);
+	int ClassifyIntoPlane(SortNode * head, SortNode * sort) const;
+	int ClassifyIntoWall(SortNode * head, SortNode * sort) const;
+	void ClassifyList(SortNode * head, SortNode * list, bool plane);
+	static void LinkSorted(SortNode * head, SortNode * sort, int side);
+	void SortWallIntoPlane(SortNode * head, SortNode * sort, int side);
+	void SortSpriteIntoPlane(SortNode * head, SortNode * sort, int side);
+	void SortWallIntoWall(HWDrawInfo *di, SortNode * head, SortNode * sort, int side);
+	void SortSpriteIntoWall(HWDrawInfo *di, SortNode * head, SortNode * sort, int side);
 	SortNode * SortSpriteList(SortNode * head);
 	SortNode * DoSort(HWDrawInfo *di, SortNode * head);
 	void Sort(HWDrawInfo *di);
@@ -20,6 +20,8 @@ class FMaterial;
 struct FTexCoordInfo;
 struct FSectorPortalGroup;
 struct FFlatVertex;
+struct FWallVertexKey;
+struct FWallVertexSlot;
 struct FLinePortalSpan;
 struct FDynLightData;
 class VSMatrix;
@@ -210,6 +212,8 @@ public:
 
 	void SetupLights(HWDrawInfo *di, FDynLightData &lightdata);
 
+	FWallVertexSlot *GetVertexSlot();
+	void GetVertexKey(FWallVertexKey &key, bool split);
 	void MakeVertices(HWDrawInfo *di, bool nosplit);
 
 	void SkyPlane(HWDrawInfo *di, sector_t *sector, int plane, bool allowmirror);
@@ -27,6 +27,7 @@
 #include "hwrenderer/scene/hw_drawstructs.h"
 
 EXTERN_CVAR(Bool, gl_seamless)
+CVAR(Bool, gl_cachewalls, true, 0)
 
 //==========================================================================
 //
@@ -256,10 +257,73 @@ int HWWall::CountVertices()
 	return (int)ptr;
 }
 
+//==========================================================================
+//
+// Finds the persistent vertex slot for this wall, if it can have one.
+// Only walls of regular sidedefs are eligible, because polyobjects
+// move constantly and all other types can appear multiple times per seg.
+//
+//==========================================================================
+
+FWallVertexSlot *HWWall::GetVertexSlot()
+{
+	if (!gl_cachewalls || seg->sidedef == nullptr || (seg->sidedef->Flags & WALLF_POLYOBJ)) return nullptr;
+
+	switch (type)
+	{
+	case RENDERWALL_TOP:
+		return screen->mVertexData->GetWallSlot(seg->Index(), FFlatVertexBuffer::WALLSLOT_TOP);
+
+	case RENDERWALL_BOTTOM:
+		return screen->mVertexData->GetWallSlot(seg->Index(), FFlatVertexBuffer::WALLSLOT_BOTTOM);
+
+	case RENDERWALL_M1S:
+	case RENDERWALL_M2S:
+		return screen->mVertexData->GetWallSlot(seg->Index(), FFlatVertexBuffer::WALLSLOT_MID);
+
+	default:
+		return nullptr;
+	}
+}
+
+//==========================================================================
+//
+// Collects everything the vertex data depends on.
+//
+//==========================================================================
+
+void HWWall::GetVertexKey(FWallVertexKey &key, bool split)
+{
+	float *c = key.coords;
+	*c++ = glseg.x1;
+	*c++ = glseg.y1;
+	*c++ = glseg.x2;
+	*c++ = glseg.y2;
+	*c++ = glseg.fracleft;
+	*c++ = glseg.fracright;
+	*c++ = ztop[0];
+	*c++ = ztop[1];
+	*c++ = zbottom[0];
+	*c++ = zbottom[1];
+	for (int i = 0; i < 4; i++)
+	{
+		*c++ = tcs[i].u;
+		*c++ = tcs[i].v;
+	}
+	// The height lists only matter if the wall gets split. Otherwise a moving neighbor would needlessly invalidate it.
+	key.heightstamp[0] = split && vertexes[0] ? vertexes[0]->heightstamp : 0;
+	key.heightstamp[1] = split && vertexes[1] ? vertexes[1]->heightstamp : 0;
+	key.flags = split ? 1 + (flags & (HWF_NOSPLITUPPER | HWF_NOSPLITLOWER)) : 0;
+}
+
 //==========================================================================
 //
 // build the vertices for this wall
 //
+// Static walls are stored persistently in the vertex buffer and only get
+// regenerated if something about them changes. Walls that cannot be cached
+// go through the per-frame vertex allocation.
+//
 //==========================================================================
 
 void HWWall::MakeVertices(HWDrawInfo *di, bool nosplit)
@@ -267,7 +331,36 @@ void HWWall::MakeVertices(HWDrawInfo *di, bool nosplit)
 	if (vertcount == 0)
 	{
 		bool split = (gl_seamless && !nosplit && seg->sidedef != nullptr && !(seg->sidedef->Flags & WALLF_POLYOBJ) && !(flags & HWF_NOSPLIT));
-		auto ret = screen->mVertexData->AllocVertices(split ? CountVertices() : 4);
+		unsigned int count = split ? CountVertices() : 4;
+		auto slot = GetVertexSlot();
+
+		if (slot != nullptr)
+		{
+			auto vbo = screen->mVertexData;
+			FWallVertexKey key;
+			GetVertexKey(key, split);
+
+			if (slot->count > 0 && slot->key == key)
+			{
+				slot->frame = vbo->GetFrame();
+				vertindex = slot->index;
+				vertcount = slot->count;
+				return;
+			}
+			// A slot that already got used in this frame may not be overwritten because some other wall may still reference it.
+			if ((slot->count == 0 || slot->frame != vbo->GetFrame()) && vbo->AllocWallSlot(slot, count))
+			{
+				auto ptr = vbo->GetBuffer(slot->index);
+				slot->key = key;
+				slot->frame = vbo->GetFrame();
+				slot->count = CreateVertices(ptr, split);
+				vertindex = slot->index;
+				vertcount = slot->count;
+				return;
+			}
+		}
+
+		auto ret = screen->mVertexData->AllocVertices(count);
 		vertindex = ret.second;
 		vertcount = CreateVertices(ret.first, split);
 	}
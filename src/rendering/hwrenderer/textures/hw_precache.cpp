@@ -223,11 +223,14 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 	if (gl_precache)
 	{
 		FImageSource::BeginPrecaching();
+		TArray<int> prefetchlumps;
+		TArray<unsigned> prefetchpos(cnt, true);	// the first entry in prefetchlumps that belongs to each texture
 
 		// cache all used textures
 		for (int i = cnt - 1; i >= 0; i--)
 		{
 			FTexture *tex = TexMan.ByIndex(i);
+			prefetchpos[i] = prefetchlumps.Size();
 			if (tex != nullptr && tex->GetImage() != nullptr)
 			{
 				if (texhitlist[i] & (FTextureManager::HIT_Wall | FTextureManager::HIT_Flat | FTextureManager::HIT_Sky))
@@ -235,6 +238,7 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 					if (tex->GetImage() && tex->SystemTextures.GetHardwareTexture(0, false) == nullptr)
 					{
 						FImageSource::RegisterForPrecache(tex->GetImage());
+						prefetchlumps.Push(tex->GetImage()->LumpNum());
 					}
 				}
 
@@ -242,13 +246,19 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 				if (spritehitlist[i] != nullptr && (*spritehitlist[i]).CheckKey(0))
 				{
 					FImageSource::RegisterForPrecache(tex->GetImage());
+					prefetchlumps.Push(tex->GetImage()->LumpNum());
 				}
 			}
 		}
 
+		// Let the worker threads decompress the image data while the textures get created.
+		// This goes through the textures in the same order as above.
+		FLumpPrefetchWindow prefetch(prefetchlumps);
+
 		// cache all used textures
 		for (int i = cnt - 1; i >= 0; i--)
 		{
+			prefetch.Advance(prefetchpos[i]);
 			FTexture *tex = TexMan.ByIndex(i);
 			if (tex != nullptr)
 			{
@@ -262,6 +272,7 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 
 
 		FImageSource::EndPrecaching();
+		Wads.DiscardPrefetchedLumps();
 
 		// cache all used models
 		FModelRenderer *renderer = screen->CreateModelRenderer(-1);
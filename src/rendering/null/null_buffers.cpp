@@ -0,0 +1,72 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Buffers of the null renderer backend
+//
+//-----------------------------------------------------------------------------
+
+#include "null_buffers.h"
+#include "null_renderstate.h"
+
+void NullBuffer::SetData(size_t size, const void *data, bool staticdata)
+{
+	mData.Resize((unsigned)size);
+	if (data && size > 0)
+	{
+		memcpy(mData.Data(), data, size);
+		nullstats.uploadbytes += size;
+	}
+	buffersize = size;
+	map = mData.Data();
+}
+
+void NullBuffer::SetSubData(size_t offset, size_t size, const void *data)
+{
+	memcpy(mData.Data() + offset, data, size);
+	nullstats.uploadbytes += size;
+}
+
+void NullBuffer::Resize(size_t newsize)
+{
+	// TArray::Resize keeps the old contents, just like the real backends do.
+	mData.Resize((unsigned)newsize);
+	buffersize = newsize;
+	map = mData.Data();
+}
+
+void *NullBuffer::Lock(unsigned int size)
+{
+	if (size > buffersize) Resize(size);
+	return map;
+}
+
+void NullBuffer::Unlock()
+{
+}
+
+void NullDataBuffer::BindRange(size_t start, size_t length)
+{
+	nullstats.bufferbinds++;
+}
+
+void NullDataBuffer::BindBase()
+{
+	nullstats.bufferbinds++;
+}
@@ -0,0 +1,68 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Buffers of the null renderer backend
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "hwrenderer/data/buffers.h"
+#include "utility/tarray.h"
+
+#ifdef _MSC_VER
+// silence bogus warning C4250: 'NullVertexBuffer': inherits 'NullBuffer::NullBuffer::SetData' via dominance
+// According to internet infos, the warning is erroneously emitted in this case.
+#pragma warning(disable:4250) 
+#endif
+
+// Buffers of the null backend only live in system memory.
+// Everything written to them is counted as an upload, nothing else happens to the data.
+
+class NullBuffer : virtual public IBuffer
+{
+public:
+	void SetData(size_t size, const void *data, bool staticdata) override;
+	void SetSubData(size_t offset, size_t size, const void *data) override;
+	void Resize(size_t newsize) override;
+
+	void *Lock(unsigned int size) override;
+	void Unlock() override;
+
+private:
+	TArray<uint8_t> mData;
+};
+
+class NullVertexBuffer : public IVertexBuffer, public NullBuffer
+{
+public:
+	void SetFormat(int numBindingPoints, int numAttributes, size_t stride, const FVertexBufferAttribute *attrs) override {}
+};
+
+class NullIndexBuffer : public IIndexBuffer, public NullBuffer
+{
+};
+
+class NullDataBuffer : public IDataBuffer, public NullBuffer
+{
+public:
+	void BindRange(size_t start, size_t length) override;
+	void BindBase() override;
+};
@@ -0,0 +1,424 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Frame buffer that runs the hardware renderer without a graphics API
+//
+//-----------------------------------------------------------------------------
+
+#include "v_video.h"
+#include "r_utility.h"
+#include "actor.h"
+#include "i_time.h"
+#include "g_levellocals.h"
+#include "a_dynlight.h"
+#include "c_dispatch.h"
+
+#include "hwrenderer/utility/hw_clock.h"
+#include "hwrenderer/utility/hw_vrmodes.h"
+#include "hwrenderer/scene/hw_skydome.h"
+#include "hwrenderer/scene/hw_fakeflat.h"
+#include "hwrenderer/scene/hw_drawinfo.h"
+#include "hwrenderer/scene/hw_portal.h"
+#include "hwrenderer/data/hw_viewpointbuffer.h"
+#include "hwrenderer/data/flatvertices.h"
+#include "hwrenderer/dynlights/hw_lightbuffer.h"
+#include "hwrenderer/textures/hw_material.h"
+
+#include "null_framebuffer.h"
+#include "null_buffers.h"
+#include "null_renderstate.h"
+
+void Draw2D(F2DDrawer *drawer, FRenderState &state);
+void DoWriteSavePic(FileWriter *file, ESSType ssformat, uint8_t *scr, int width, int height, sector_t *viewsector, bool upsidedown);
+
+EXTERN_CVAR(Bool, r_drawvoxels)
+EXTERN_CVAR(Bool, cl_capfps)
+EXTERN_CVAR(Bool, gl_no_skyclear)
+EXTERN_CVAR(Int, vid_defwidth)
+EXTERN_CVAR(Int, vid_defheight)
+
+extern bool NoInterpolateView;
+
+cycle_t NullFrameBuffer::SceneCycles;
+
+static NullRenderStats lastframestats;
+static double lastscenetime;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void NullHardwareTexture::AllocateBuffer(int w, int h, int texelsize)
+{
+	mBuffer.Resize(w * h * texelsize);
+	bufferpitch = w;
+}
+
+uint8_t *NullHardwareTexture::MapBuffer()
+{
+	return mBuffer.Data();
+}
+
+unsigned int NullHardwareTexture::CreateTexture(unsigned char * buffer, int w, int h, int texunit, bool mipmap, int translation, const char *name)
+{
+	return 0;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+NullFrameBuffer::NullFrameBuffer(int width, int height) : Super(width, height)
+{
+	mClientWidth = width;
+	mClientHeight = height;
+}
+
+NullFrameBuffer::~NullFrameBuffer()
+{
+	delete mVertexData;
+	delete mSkyData;
+	delete mViewpoints;
+	delete mLights;
+	mShadowMap.Reset();
+}
+
+void NullFrameBuffer::InitializeState()
+{
+	gl_vendorstring = "Null";
+	hwcaps = RFL_SHADER_STORAGE_BUFFER | RFL_BUFFER_STORAGE;
+	glslversion = 4.50f;
+
+	mVertexData = new FFlatVertexBuffer(GetWidth(), GetHeight());
+	mSkyData = new FSkyVertexBuffer;
+	mViewpoints = new GLViewpointBuffer;
+	mLights = new FLightBuffer();
+
+	mRenderState.reset(new NullRenderState());
+}
+
+void NullFrameBuffer::Update()
+{
+	twoD.Reset();
+	Flush3D.Reset();
+
+	Flush3D.Clock();
+	Draw2D();
+	Clear2D();
+	Flush3D.Unclock();
+
+	lastframestats = nullstats;
+	lastscenetime = SceneCycles.TimeMS();
+	nullstats.Reset();
+
+	Super::Update();
+}
+
+void NullFrameBuffer::SetWindowSize(int w, int h)
+{
+	mClientWidth = w;
+	mClientHeight = h;
+}
+
+void NullFrameBuffer::Draw2D()
+{
+	::Draw2D(&m2DDrawer, *mRenderState);
+}
+
+uint32_t NullFrameBuffer::GetCaps()
+{
+	// This always runs the hardware renderer, regardless of vid_rendermode.
+	ActorRenderFeatureFlags FlagSet = RFF_FLATSPRITES | RFF_MODELS | RFF_SLOPE3DFLOORS |
+		RFF_TILTPITCH | RFF_ROLLSPRITES | RFF_POLYGONAL | RFF_MATSHADER | RFF_POSTSHADER | RFF_BRIGHTMAP | RFF_TRUECOLOR;
+	if (r_drawvoxels)
+		FlagSet |= RFF_VOXELS;
+
+	return (uint32_t)FlagSet;
+}
+
+IHardwareTexture *NullFrameBuffer::CreateHardwareTexture()
+{
+	return new NullHardwareTexture();
+}
+
+IVertexBuffer *NullFrameBuffer::CreateVertexBuffer()
+{
+	return new NullVertexBuffer();
+}
+
+IIndexBuffer *NullFrameBuffer::CreateIndexBuffer()
+{
+	return new NullIndexBuffer();
+}
+
+IDataBuffer *NullFrameBuffer::CreateDataBuffer(int bindingpoint, bool ssbo, bool needsresize)
+{
+	return new NullDataBuffer();
+}
+
+//==========================================================================
+//
+// The save picture goes through the full scene setup, but since nothing
+// gets rendered the image itself is black.
+//
+//==========================================================================
+
+void NullFrameBuffer::WriteSavePic(player_t *player, FileWriter *file, int width, int height)
+{
+	IntRect bounds;
+	bounds.left = 0;
+	bounds.top = 0;
+	bounds.width = width;
+	bounds.height = height;
+
+	hw_ClearFakeFlat();
+	mRenderState->SetVertexBuffer(mVertexData);
+	mVertexData->Reset();
+	mLights->Clear();
+	mViewpoints->Clear();
+
+	// This shouldn't overwrite the global viewpoint even for a short time.
+	FRenderViewpoint savevp;
+	sector_t *viewsector = RenderViewpoint(savevp, players[consoleplayer].camera, &bounds, r_viewpoint.FieldOfView.Degrees, 1.6f, 1.6f, true, false);
+
+	TArray<uint8_t> scr(width * height * 3, true);
+	memset(scr.Data(), 0, scr.Size());
+	DoWriteSavePic(file, SS_RGB, scr.Data(), width, height, viewsector, false);
+
+	screen->SetViewportRects(nullptr);
+}
+
+//==========================================================================
+//
+// This mirrors VulkanFrameBuffer::RenderView, minus everything that
+// would require a real render target.
+//
+//==========================================================================
+
+sector_t *NullFrameBuffer::RenderView(player_t *player)
+{
+	mRenderState->SetVertexBuffer(mVertexData);
+	mVertexData->Reset();
+
+	hw_ClearFakeFlat();
+
+	iter_dlightf = iter_dlight = draw_dlight = draw_dlightf = 0;
+
+	checkBenchActive();
+
+	// reset statistics counters
+	ResetProfilingData();
+	SceneCycles.Reset();
+
+	// Get this before everything else
+	if (cl_capfps || r_NoInterpolate) r_viewpoint.TicFrac = 1.;
+	else r_viewpoint.TicFrac = I_GetTimeFrac();
+
+	mLights->Clear();
+	mViewpoints->Clear();
+
+	// NoInterpolateView should have no bearing on camera textures, but needs to be preserved for the main view below.
+	bool saved_niv = NoInterpolateView;
+	NoInterpolateView = false;
+
+	// Shader start time does not need to be handled per level. Just use the one from the camera to render from.
+	mRenderState->CheckTimer(player->camera->Level->ShaderStartTime);
+	// prepare all camera textures that have been used in the last frame.
+	// This must be done for all levels, not just the primary one!
+	for (auto Level : AllLevels())
+	{
+		Level->canvasTextureInfo.UpdateAll([&](AActor *camera, FCanvasTexture *camtex, double fov)
+		{
+			RenderTextureView(camtex, camera, fov);
+		});
+	}
+	NoInterpolateView = saved_niv;
+
+	// now render the main view
+	float fovratio;
+	float ratio = r_viewwindow.WidescreenRatio;
+	if (r_viewwindow.WidescreenRatio >= 1.3f)
+	{
+		fovratio = 1.333333f;
+	}
+	else
+	{
+		fovratio = ratio;
+	}
+
+	sector_t *retsec = RenderViewpoint(r_viewpoint, player->camera, NULL, r_viewpoint.FieldOfView.Degrees, ratio, fovratio, true, true);
+	All.Unclock();
+	return retsec;
+}
+
+//==========================================================================
+//
+// Renders one viewpoint in a scene.
+// Stereo 3D is not supported because there is nothing to look at.
+//
+//==========================================================================
+
+sector_t *NullFrameBuffer::RenderViewpoint(FRenderViewpoint &mainvp, AActor * camera, IntRect * bounds, float fov, float ratio, float fovratio, bool mainview, bool toscreen)
+{
+	R_SetupFrame(mainvp, r_viewwindow, camera);
+
+	// The AABB tree and light list get prepared even though there is no shadow map to render them into.
+	if (mainview && toscreen && mShadowMap.PerformUpdate())
+		mShadowMap.FinishUpdate();
+
+	// Update the attenuation flag of all light defaults for each viewpoint.
+	// This function will only do something if the setting differs.
+	FLightDefaults::SetAttenuationForLevel(!!(camera->Level->flags3 & LEVEL3_ATTENUATE));
+
+	const auto &eye = VRMode::GetVRMode(false)->mEyes[0];
+	screen->SetViewportRects(bounds);
+
+	if (mainview)
+	{
+		mRenderState->SetPassType(NORMAL_PASS);
+		mRenderState->EnableDrawBuffers(mRenderState->GetPassDrawBufferCount());
+	}
+
+	auto di = HWDrawInfo::StartDrawInfo(mainvp.ViewLevel, nullptr, mainvp, nullptr);
+	auto &vp = di->Viewpoint;
+
+	di->Set3DViewport(*mRenderState);
+	di->SetViewArea();
+	auto cm = di->SetFullbrightFlags(mainview ? vp.camera->player : nullptr);
+	di->Viewpoint.FieldOfView = fov;	// Set the real FOV for the current scene (it's not necessarily the same as the global setting in r_viewpoint)
+
+	di->VPUniforms.mProjectionMatrix = eye.GetProjection(fov, ratio, fovratio);
+	vp.Pos += eye.GetViewShift(vp.HWAngles.Yaw.Degrees);
+	di->SetupView(*mRenderState, vp.Pos.X, vp.Pos.Y, vp.Pos.Z, false, false);
+
+	di->ProcessScene(toscreen, [&](HWDrawInfo *di, int mode) {
+		DrawScene(di, mode);
+	});
+
+	if (mainview)
+	{
+		PostProcess.Clock();
+		if (toscreen) di->EndDrawScene(mainvp.sector, *mRenderState); // do not call this for camera textures.
+		PostProcessScene(cm, [&]() { di->DrawEndScene2D(mainvp.sector, *mRenderState); });
+		PostProcess.Unclock();
+	}
+	di->EndDrawInfo();
+
+	return mainvp.sector;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void NullFrameBuffer::RenderTextureView(FCanvasTexture *tex, AActor *Viewpoint, double FOV)
+{
+	FMaterial *mat = FMaterial::ValidateTexture(tex, false);
+
+	int width = mat->TextureWidth();
+	int height = mat->TextureHeight();
+
+	IntRect bounds;
+	bounds.left = bounds.top = 0;
+	bounds.width = mat->GetWidth();
+	bounds.height = mat->GetHeight();
+
+	FRenderViewpoint texvp;
+	RenderViewpoint(texvp, Viewpoint, &bounds, FOV, (float)width / height, (float)width / height, false, false);
+
+	tex->SetUpdated(true);
+}
+
+//==========================================================================
+//
+// Same as the scene drawer of the real backends, without SSAO.
+// The scene setup time is tracked separately here, because that is
+// what this backend is meant to measure.
+//
+//==========================================================================
+
+void NullFrameBuffer::DrawScene(HWDrawInfo *di, int drawmode)
+{
+	static int recursion = 0;
+	const auto &vp = di->Viewpoint;
+
+	SceneCycles.Clock();
+	if (vp.camera != nullptr)
+	{
+		ActorRenderFlags savedflags = vp.camera->renderflags;
+		di->CreateScene(drawmode == DM_MAINVIEW);
+		vp.camera->renderflags = savedflags;
+	}
+	else
+	{
+		di->CreateScene(false);
+	}
+	SceneCycles.Unclock();
+
+	mRenderState->SetDepthMask(true);
+	if (!gl_no_skyclear) mPortalState->RenderFirstSkyPortal(recursion, di, *mRenderState);
+
+	di->RenderScene(*mRenderState);
+
+	// Handle all portals after rendering the opaque objects but before
+	// doing all translucent stuff
+	recursion++;
+	mPortalState->EndFrame(di, *mRenderState);
+	recursion--;
+	di->RenderTranslucent(*mRenderState);
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+DFrameBuffer *NullVideo::CreateFrameBuffer()
+{
+	return new NullFrameBuffer(vid_defwidth, vid_defheight);
+}
+
+IVideo *null_CreateVideo()
+{
+	return new NullVideo();
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+ADD_STAT(nullrender)
+{
+	FString out;
+	out.Format("Draws: %d (%d vertices), indexed draws: %d (%d indices), clears: %d\n"
+		"Buffer binds: %d, uploads: %llu bytes, scene setup: %2.3f ms",
+		lastframestats.drawcalls, lastframestats.vertices, lastframestats.indexeddrawcalls, lastframestats.indices, lastframestats.clears,
+		lastframestats.bufferbinds, (unsigned long long)lastframestats.uploadbytes, lastscenetime);
+	return out;
+}
@@ -0,0 +1,104 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Frame buffer that runs the hardware renderer without a graphics API
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "v_video.h"
+#include "i_video.h"
+#include "hwrenderer/textures/hw_ihwtexture.h"
+#include <memory>
+
+struct FRenderViewpoint;
+struct HWDrawInfo;
+class NullRenderState;
+class FCanvasTexture;
+
+//==========================================================================
+//
+// A frame buffer that runs the entire hardware renderer scene setup
+// but never talks to a graphics API. All buffers live in system memory
+// and the render state only counts what it gets asked to do.
+// This allows profiling the CPU side of the renderer on machines without
+// a GPU. Select it with the -nullrenderer command line parameter.
+//
+//==========================================================================
+
+class NullHardwareTexture : public IHardwareTexture
+{
+public:
+	void AllocateBuffer(int w, int h, int texelsize) override;
+	uint8_t *MapBuffer() override;
+	unsigned int CreateTexture(unsigned char * buffer, int w, int h, int texunit, bool mipmap, int translation, const char *name) override;
+
+private:
+	TArray<uint8_t> mBuffer;
+};
+
+class NullFrameBuffer : public DFrameBuffer
+{
+	typedef DFrameBuffer Super;
+
+public:
+	NullFrameBuffer(int width, int height);
+	~NullFrameBuffer();
+
+	void InitializeState() override;
+	void Update() override;
+
+	bool IsFullscreen() override { return false; }
+	int GetClientWidth() override { return mClientWidth; }
+	int GetClientHeight() override { return mClientHeight; }
+	void SetWindowSize(int w, int h) override;
+
+	uint32_t GetCaps() override;
+	void WriteSavePic(player_t *player, FileWriter *file, int width, int height) override;
+	sector_t *RenderView(player_t *player) override;
+	void Draw2D() override;
+
+	IHardwareTexture *CreateHardwareTexture() override;
+	IVertexBuffer *CreateVertexBuffer() override;
+	IIndexBuffer *CreateIndexBuffer() override;
+	IDataBuffer *CreateDataBuffer(int bindingpoint, bool ssbo, bool needsresize) override;
+
+	NullRenderState *GetRenderState() { return mRenderState.get(); }
+
+	static cycle_t SceneCycles;
+
+private:
+	sector_t *RenderViewpoint(FRenderViewpoint &mainvp, AActor * camera, IntRect * bounds, float fov, float ratio, float fovratio, bool mainview, bool toscreen);
+	void RenderTextureView(FCanvasTexture *tex, AActor *Viewpoint, double FOV);
+	void DrawScene(HWDrawInfo *di, int drawmode);
+
+	std::unique_ptr<NullRenderState> mRenderState;
+	int mClientWidth;
+	int mClientHeight;
+};
+
+class NullVideo : public IVideo
+{
+public:
+	DFrameBuffer *CreateFrameBuffer() override;
+};
+
+IVideo *null_CreateVideo();
@@ -0,0 +1,78 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Render state of the null renderer backend
+//
+//-----------------------------------------------------------------------------
+
+#include "null_renderstate.h"
+#include "hwrenderer/data/flatvertices.h"
+
+NullRenderStats nullstats;
+
+NullRenderState::NullRenderState()
+{
+	Reset();
+}
+
+//==========================================================================
+//
+// The real backends translate the accumulated state into API calls here.
+// This only needs to consume the state changes that get tracked
+// between draws so that their bookkeeping does not pile up.
+//
+//==========================================================================
+
+void NullRenderState::Apply()
+{
+	mMaterial.mChanged = false;
+	mBias.mChanged = false;
+}
+
+void NullRenderState::ClearScreen()
+{
+	Draw(DT_TriangleStrip, FFlatVertexBuffer::FULLSCREEN_INDEX, 4);
+}
+
+void NullRenderState::Draw(int dt, int index, int count, bool apply)
+{
+	if (apply) Apply();
+	nullstats.drawcalls++;
+	nullstats.vertices += count;
+}
+
+void NullRenderState::DrawIndexed(int dt, int index, int count, bool apply)
+{
+	if (apply) Apply();
+	nullstats.indexeddrawcalls++;
+	nullstats.indices += count;
+}
+
+bool NullRenderState::SetDepthClamp(bool on)
+{
+	bool lastValue = mDepthClamp;
+	mDepthClamp = on;
+	return lastValue;
+}
+
+void NullRenderState::Clear(int targets)
+{
+	nullstats.clears++;
+}
@@ -0,0 +1,81 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Render state of the null renderer backend
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include "hwrenderer/scene/hw_renderstate.h"
+
+// Everything the null backend gets asked to do, per frame.
+struct NullRenderStats
+{
+	int drawcalls;
+	int indexeddrawcalls;
+	int vertices;
+	int indices;
+	int clears;
+	int bufferbinds;
+	size_t uploadbytes;
+
+	void Reset()
+	{
+		drawcalls = indexeddrawcalls = vertices = indices = clears = bufferbinds = 0;
+		uploadbytes = 0;
+	}
+};
+
+extern NullRenderStats nullstats;
+
+class NullRenderState : public FRenderState
+{
+public:
+	NullRenderState();
+
+	// Draw commands
+	void ClearScreen() override;
+	void Draw(int dt, int index, int count, bool apply = true) override;
+	void DrawIndexed(int dt, int index, int count, bool apply = true) override;
+
+	// Immediate render state change commands. These only change infrequently and should not clutter the render state.
+	bool SetDepthClamp(bool on) override;
+	void SetDepthMask(bool on) override {}
+	void SetDepthFunc(int func) override {}
+	void SetDepthRange(float min, float max) override {}
+	void SetColorMask(bool r, bool g, bool b, bool a) override {}
+	void SetStencil(int offs, int op, int flags = -1) override {}
+	void SetCulling(int mode) override {}
+	void EnableClipDistance(int num, bool state) override {}
+	void Clear(int targets) override;
+	void EnableStencil(bool on) override {}
+	void SetScissor(int x, int y, int w, int h) override {}
+	void SetViewport(int x, int y, int w, int h) override {}
+	void EnableDepthTest(bool on) override {}
+	void EnableMultisampling(bool on) override {}
+	void EnableLineSmooth(bool on) override {}
+	void EnableDrawBuffers(int count) override {}
+
+private:
+	void Apply();
+
+	bool mDepthClamp = true;
+};
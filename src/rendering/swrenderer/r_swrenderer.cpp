@@ -185,6 +185,8 @@ void FSoftwareRenderer::Precache(uint8_t *texhitlist, TMap<PClassActor*, bool> &
 
 void FSoftwareRenderer::RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch)
 {
+	FSoftwareTexture::TrimCache();
+
 	if (V_IsPolyRenderer())
 	{
 		PolyRenderer::Instance()->Viewpoint = r_viewpoint;
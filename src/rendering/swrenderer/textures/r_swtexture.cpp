@@ -38,9 +38,13 @@
 #include "bitmap.h"
 #include "m_alloc.h"
 #include "imagehelpers.h"
+#include "cachebudget.h"
 
 EXTERN_CVAR(Bool, gl_texture_usehires)
 
+TArray<FSoftwareTexture *> FSoftwareTexture::LoadedTextures;
+int FSoftwareTexture::CurrentFrame;
+
 
 FSoftwareTexture *FTexture::GetSoftwareTexture()
 {
@@ -72,6 +76,72 @@ FSoftwareTexture::FSoftwareTexture(FTexture *tex)
 	CalcBitSize();
 }
 
+FSoftwareTexture::~FSoftwareTexture()
+{
+	FreeAllSpans();
+	Pixels.Reset();
+	PixelsBgra.Reset();
+	UpdateCacheSize();
+}
+
+//==========================================================================
+//
+// Keeps track of how much pixel data this texture holds
+//
+//==========================================================================
+
+void FSoftwareTexture::UpdateCacheSize()
+{
+	size_t bytes = Pixels.Size() + PixelsBgra.Size() * sizeof(uint32_t);
+	CacheResident[CACHE_SWTextures] += bytes - CachedBytes;
+	CachedBytes = bytes;
+
+	if (bytes > 0 && CacheIndex < 0)
+	{
+		CacheIndex = LoadedTextures.Push(this);
+	}
+	else if (bytes == 0 && CacheIndex >= 0)
+	{
+		auto last = LoadedTextures.Last();
+		LoadedTextures[CacheIndex] = last;
+		last->CacheIndex = CacheIndex;
+		LoadedTextures.Pop();
+		CacheIndex = -1;
+	}
+}
+
+//==========================================================================
+//
+// Unloads the least recently used textures if the cache budget is
+// exceeded. Must be called before a frame gets rendered, when no pointers
+// to any pixel data are being held.
+//
+//==========================================================================
+
+void FSoftwareTexture::TrimCache()
+{
+	CurrentFrame++;
+	if (!CacheOverBudget()) return;
+
+	// Lump data is cheaper to get back than texture pixels.
+	TrimLumpCache();
+	if (!CacheOverBudget()) return;
+
+	TArray<FSoftwareTexture *> sorted = LoadedTextures;
+	std::sort(sorted.begin(), sorted.end(), [](FSoftwareTexture *a, FSoftwareTexture *b)
+	{
+		return a->LastUsedFrame < b->LastUsedFrame;
+	});
+
+	for (auto tex : sorted)
+	{
+		// Anything used by the last frame is likely to be needed again right away, so keep it even if that means staying over budget.
+		if (!CacheOverBudget() || tex->LastUsedFrame >= CurrentFrame - 1) break;
+		tex->Unload();
+		CacheEvictions[CACHE_SWTextures]++;
+	}
+}
+
 //==========================================================================
 //
 //
@@ -113,6 +183,7 @@ void FSoftwareTexture::CalcBitSize ()
 
 const uint8_t *FSoftwareTexture::GetPixels(int style)
 {
+	LastUsedFrame = CurrentFrame;
 	if (Pixels.Size() == 0 || CheckModified(style))
 	{
 		if (mPhysicalScale == 1)
@@ -145,6 +216,7 @@ const uint8_t *FSoftwareTexture::GetPixels(int style)
 				}
 			}
 		}
+		UpdateCacheSize();
 	}
 	return Pixels.Data();
 }
@@ -157,6 +229,7 @@ const uint8_t *FSoftwareTexture::GetPixels(int style)
 
 const uint32_t *FSoftwareTexture::GetPixelsBgra()
 {
+	LastUsedFrame = CurrentFrame;
 	if (PixelsBgra.Size() == 0 || CheckModified(2))
 	{
 		if (mPhysicalScale == 1)
@@ -178,6 +251,7 @@ const uint32_t *FSoftwareTexture::GetPixelsBgra()
 			}
 			GenerateBgraMipmaps();
 		}
+		UpdateCacheSize();
 	}
 	return PixelsBgra.Data();
 }
@@ -26,6 +26,14 @@ protected:
 	int mPhysicalScale;
 	int mBufferFlags;
 
+	// For evicting the pixel data when the cache budget is exceeded.
+	int LastUsedFrame = 0;
+	int CacheIndex = -1;		// position in LoadedTextures, -1 if no pixels are loaded
+	size_t CachedBytes = 0;
+	static TArray<FSoftwareTexture *> LoadedTextures;
+	static int CurrentFrame;
+
+	void UpdateCacheSize();
 	void FreeAllSpans();
 	template<class T> FSoftwareTextureSpan **CreateSpans(const T *pixels);
 	void FreeSpans(FSoftwareTextureSpan **spans);
@@ -34,10 +42,9 @@ protected:
 public:
 	FSoftwareTexture(FTexture *tex);
 	
-	virtual ~FSoftwareTexture()
-	{
-		FreeAllSpans();
-	}
+	virtual ~FSoftwareTexture();
+
+	static void TrimCache();
 
 	FTexture *GetTexture() const
 	{
@@ -100,6 +107,7 @@ public:
 	{
 		Pixels.Reset();
 		PixelsBgra.Reset();
+		UpdateCacheSize();
 	}
 	
 	// Returns true if the next call to GetPixels() will return an image different from the
@@ -513,6 +513,18 @@ void S_PrecacheLevel (FLevelLocals *Level)
 			chan->SoundID.MarkUsed();
 		}
 
+		// Let the worker threads decompress the sound lumps while they get loaded one by one.
+		TArray<int> prefetchlumps;
+		for (i = 1; i < S_sfx.Size(); ++i)
+		{
+			auto sfx = &S_sfx[i];
+			if (sfx->bUsed && !sfx->bPlayerReserve && !sfx->bRandomHeader && sfx->link == sfxinfo_t::NO_LINK && !sfx->data.isValid())
+			{
+				prefetchlumps.Push(sfx->lumpnum);
+			}
+		}
+		Wads.PrefetchLumps(prefetchlumps);
+
 		for (i = 1; i < S_sfx.Size(); ++i)
 		{
 			if (S_sfx[i].bUsed)
@@ -520,6 +532,7 @@ void S_PrecacheLevel (FLevelLocals *Level)
 				S_CacheSound (&S_sfx[i]);
 			}
 		}
+		Wads.DiscardPrefetchedLumps();
 		for (i = 1; i < S_sfx.Size(); ++i)
 		{
 			if (!S_sfx[i].bUsed && S_sfx[i].link == sfxinfo_t::NO_LINK)
@@ -140,6 +140,307 @@ struct FJSONObject
 	}
 };
 
+//==========================================================================
+//
+// Binary save format
+//
+// This stores the same data as the JSON writer but does not need to
+// format or parse any text. Keys are only written out in full the first
+// time they are used and after that by their index. When reading, the
+// data is fed into a RapidJSON document so that the rest of the
+// serializer works the same for both formats.
+//
+//==========================================================================
+
+static const char BinaryMagic[4] = { 'B', 'S', 'E', 'R' };
+enum { BINARY_VERSION = 1 };
+
+enum EBinaryTag
+{
+	BT_End,
+	BT_Null,
+	BT_False,
+	BT_True,
+	BT_Int,			// zigzag encoded varint
+	BT_Uint64,		// varint, only for values that do not fit into an int64_t
+	BT_Double,		// 8 bytes, little endian
+	BT_String,		// varint length, followed by the text
+	BT_Object,		// key/value pairs, terminated by a 0 key
+	BT_Array,		// values, terminated by BT_End
+};
+
+// Keys in an object are 0 for the end of the object, 1 for a new key whose
+// length and text follow, or the index of a previously written key plus 2.
+enum
+{
+	BK_End,
+	BK_New,
+	BK_First
+};
+
+struct FBinaryWriter
+{
+	rapidjson::StringBuffer &mOut;
+	TArray<char> mKeyText;
+	TArray<unsigned> mKeyOffsets;
+	TArray<int> mKeyHash;
+
+	FBinaryWriter(rapidjson::StringBuffer &out) : mOut(out)
+	{
+		mKeyHash.Resize(1024);
+		memset(mKeyHash.Data(), 0xff, mKeyHash.Size() * sizeof(int));
+		memcpy(mOut.Push(sizeof(BinaryMagic)), BinaryMagic, sizeof(BinaryMagic));
+		mOut.Put(BINARY_VERSION);
+	}
+
+	void Varint(uint64_t v)
+	{
+		while (v >= 0x80)
+		{
+			mOut.Put(char((v & 0x7f) | 0x80));
+			v >>= 7;
+		}
+		mOut.Put(char(v));
+	}
+
+	void Bytes(const char *k, size_t len)
+	{
+		Varint(len);
+		if (len > 0) memcpy(mOut.Push(len), k, len);
+	}
+
+	static unsigned HashKey(const char *k, size_t len)
+	{
+		unsigned hash = 2166136261u;
+		for (size_t i = 0; i < len; i++)
+		{
+			hash = (hash ^ (uint8_t)k[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	void Key(const char *k)
+	{
+		size_t len = strlen(k);
+		unsigned mask = mKeyHash.Size() - 1;
+		unsigned slot = HashKey(k, len) & mask;
+
+		for (; mKeyHash[slot] != -1; slot = (slot + 1) & mask)
+		{
+			const char *key = &mKeyText[mKeyOffsets[mKeyHash[slot]]];
+			if (!strcmp(key, k))
+			{
+				Varint(mKeyHash[slot] + BK_First);
+				return;
+			}
+		}
+		mKeyHash[slot] = mKeyOffsets.Push(mKeyText.Size());
+		memcpy(&mKeyText[mKeyText.Reserve(len + 1)], k, len + 1);
+		Varint(BK_New);
+		Bytes(k, len);
+
+		// Keep the hash table at most half full.
+		if (mKeyOffsets.Size() * 2 > mKeyHash.Size())
+		{
+			mKeyHash.Resize(mKeyHash.Size() * 2);
+			memset(mKeyHash.Data(), 0xff, mKeyHash.Size() * sizeof(int));
+			mask = mKeyHash.Size() - 1;
+			for (unsigned i = 0; i < mKeyOffsets.Size(); i++)
+			{
+				const char *key = &mKeyText[mKeyOffsets[i]];
+				for (slot = HashKey(key, strlen(key)) & mask; mKeyHash[slot] != -1; slot = (slot + 1) & mask) {}
+				mKeyHash[slot] = i;
+			}
+		}
+	}
+
+	void StartObject() { mOut.Put(BT_Object); }
+	void EndObject() { Varint(BK_End); }
+	void StartArray() { mOut.Put(BT_Array); }
+	void EndArray() { mOut.Put(BT_End); }
+	void Null() { mOut.Put(BT_Null); }
+	void Bool(bool k) { mOut.Put(k ? BT_True : BT_False); }
+
+	void Int64(int64_t k)
+	{
+		mOut.Put(BT_Int);
+		Varint((uint64_t(k) << 1) ^ uint64_t(k >> 63));
+	}
+
+	void Uint64(uint64_t k)
+	{
+		if (k <= INT64_MAX)
+		{
+			Int64(int64_t(k));
+		}
+		else
+		{
+			mOut.Put(BT_Uint64);
+			Varint(k);
+		}
+	}
+
+	void Double(double k)
+	{
+		uint64_t bits;
+		memcpy(&bits, &k, sizeof(bits));
+		mOut.Put(BT_Double);
+		char *p = mOut.Push(8);
+		for (int i = 0; i < 8; i++)
+		{
+			p[i] = char(bits >> (i * 8));
+		}
+	}
+
+	void String(const char *k)
+	{
+		mOut.Put(BT_String);
+		Bytes(k, strlen(k));
+	}
+};
+
+//==========================================================================
+//
+// Generates the SAX events to build a RapidJSON document out of binary data.
+// Returns false for any kind of broken data.
+//
+//==========================================================================
+
+struct FBinaryReader
+{
+	const uint8_t *mData;
+	const uint8_t *mEnd;
+	TArray<const char *> mKeys;
+	TArray<unsigned> mKeyLengths;
+
+	FBinaryReader(const char *buffer, size_t length)
+	{
+		mData = (const uint8_t *)buffer + sizeof(BinaryMagic) + 1;
+		mEnd = (const uint8_t *)buffer + length;
+	}
+
+	static bool IsBinary(const char *buffer, size_t length)
+	{
+		return length > sizeof(BinaryMagic) && !memcmp(buffer, BinaryMagic, sizeof(BinaryMagic)) && buffer[sizeof(BinaryMagic)] == BINARY_VERSION;
+	}
+
+	bool Varint(uint64_t &v)
+	{
+		v = 0;
+		for (int shift = 0; shift < 64 && mData < mEnd; shift += 7)
+		{
+			uint8_t c = *mData++;
+			v |= uint64_t(c & 0x7f) << shift;
+			if (!(c & 0x80)) return true;
+		}
+		return false;
+	}
+
+	bool Bytes(const char *&k, unsigned &len)
+	{
+		uint64_t v;
+		if (!Varint(v) || v > uint64_t(mEnd - mData)) return false;
+		k = (const char *)mData;
+		len = (unsigned)v;
+		mData += len;
+		return true;
+	}
+
+	template<class Handler>
+	bool Value(Handler &handler, int depth)
+	{
+		uint64_t v;
+		const char *k;
+		unsigned len;
+
+		if (mData >= mEnd || depth > 1000) return false;
+		switch (*mData++)
+		{
+		case BT_Null:
+			return handler.Null();
+
+		case BT_False:
+			return handler.Bool(false);
+
+		case BT_True:
+			return handler.Bool(true);
+
+		case BT_Int:
+			return Varint(v) && handler.Int64(int64_t(v >> 1) ^ -int64_t(v & 1));
+
+		case BT_Uint64:
+			return Varint(v) && handler.Uint64(v);
+
+		case BT_Double:
+		{
+			if (mEnd - mData < 8) return false;
+			uint64_t bits = 0;
+			for (int i = 0; i < 8; i++)
+			{
+				bits |= uint64_t(mData[i]) << (i * 8);
+			}
+			mData += 8;
+			double d;
+			memcpy(&d, &bits, sizeof(d));
+			return handler.Double(d);
+		}
+
+		case BT_String:
+			return Bytes(k, len) && handler.String(k, len, true);
+
+		case BT_Object:
+		{
+			unsigned count = 0;
+			if (!handler.StartObject()) return false;
+			for (;;)
+			{
+				if (!Varint(v)) return false;
+				if (v == BK_End) break;
+				if (v == BK_New)
+				{
+					if (!Bytes(k, len)) return false;
+					mKeys.Push(k);
+					mKeyLengths.Push(len);
+				}
+				else if (v - BK_First < mKeys.Size())
+				{
+					k = mKeys[unsigned(v - BK_First)];
+					len = mKeyLengths[unsigned(v - BK_First)];
+				}
+				else return false;
+
+				if (!handler.Key(k, len, true) || !Value(handler, depth + 1)) return false;
+				count++;
+			}
+			return handler.EndObject(count);
+		}
+
+		case BT_Array:
+		{
+			unsigned count = 0;
+			if (!handler.StartArray()) return false;
+			while (mData < mEnd && *mData != BT_End)
+			{
+				if (!Value(handler, depth + 1)) return false;
+				count++;
+			}
+			if (mData >= mEnd) return false;
+			mData++;
+			return handler.EndArray(count);
+		}
+
+		default:
+			return false;
+		}
+	}
+
+	template<class Handler>
+	bool operator()(Handler &handler)
+	{
+		return Value(handler, 0);
+	}
+};
+
 //==========================================================================
 //
 // some wrapper stuff to keep the RapidJSON dependencies out of the global headers.
@@ -154,21 +455,30 @@ struct FWriter
 
 	Writer *mWriter1;
 	PrettyWriter *mWriter2;
+	FBinaryWriter *mWriter3;
 	TArray<bool> mInObject;
 	rapidjson::StringBuffer mOutString;
 	TArray<DObject *> mDObjects;
 	TMap<DObject *, int> mObjectMap;
+	FString mPendingKey;		// an object that only gets written once something is stored in it.
+	bool mDeferNext = false;
+	bool mPending = false;
 	
-	FWriter(bool pretty)
+	FWriter(bool pretty, bool binary = false)
 	{
-		if (!pretty)
+		mWriter1 = nullptr;
+		mWriter2 = nullptr;
+		mWriter3 = nullptr;
+		if (binary)
+		{
+			mWriter3 = new FBinaryWriter(mOutString);
+		}
+		else if (!pretty)
 		{
 			mWriter1 = new Writer(mOutString);
-			mWriter2 = nullptr;
 		}
 		else
 		{
-			mWriter1 = nullptr;
 			mWriter2 = new PrettyWriter(mOutString);
 		}
 	}
@@ -177,6 +487,7 @@ struct FWriter
 	{
 		if (mWriter1) delete mWriter1;
 		if (mWriter2) delete mWriter2;
+		if (mWriter3) delete mWriter3;
 	}
 
 
@@ -185,40 +496,56 @@ struct FWriter
 		return mInObject.Size() > 0 && mInObject.Last();
 	}
 
+	void FlushPending()
+	{
+		if (mPending)
+		{
+			mPending = false;
+			Key(mPendingKey.GetChars());
+			StartObject();
+		}
+	}
+
 	void StartObject()
 	{
 		if (mWriter1) mWriter1->StartObject();
 		else if (mWriter2) mWriter2->StartObject();
+		else if (mWriter3) mWriter3->StartObject();
 	}
 
 	void EndObject()
 	{
 		if (mWriter1) mWriter1->EndObject();
 		else if (mWriter2) mWriter2->EndObject();
+		else if (mWriter3) mWriter3->EndObject();
 	}
 
 	void StartArray()
 	{
 		if (mWriter1) mWriter1->StartArray();
 		else if (mWriter2) mWriter2->StartArray();
+		else if (mWriter3) mWriter3->StartArray();
 	}
 
 	void EndArray()
 	{
 		if (mWriter1) mWriter1->EndArray();
 		else if (mWriter2) mWriter2->EndArray();
+		else if (mWriter3) mWriter3->EndArray();
 	}
 
 	void Key(const char *k)
 	{
 		if (mWriter1) mWriter1->Key(k);
 		else if (mWriter2) mWriter2->Key(k);
+		else if (mWriter3) mWriter3->Key(k);
 	}
 
 	void Null()
 	{
 		if (mWriter1) mWriter1->Null();
 		else if (mWriter2) mWriter2->Null();
+		else if (mWriter3) mWriter3->Null();
 	}
 
 	void StringU(const char *k, bool encode)
@@ -226,6 +553,7 @@ struct FWriter
 		if (encode) k = StringToUnicode(k);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void String(const char *k)
@@ -233,6 +561,7 @@ struct FWriter
 		k = StringToUnicode(k);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void String(const char *k, int size)
@@ -240,36 +569,42 @@ struct FWriter
 		k = StringToUnicode(k, size);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
+		else if (mWriter3) mWriter3->String(k);
 	}
 
 	void Bool(bool k)
 	{
 		if (mWriter1) mWriter1->Bool(k);
 		else if (mWriter2) mWriter2->Bool(k);
+		else if (mWriter3) mWriter3->Bool(k);
 	}
 
 	void Int(int32_t k)
 	{
 		if (mWriter1) mWriter1->Int(k);
 		else if (mWriter2) mWriter2->Int(k);
+		else if (mWriter3) mWriter3->Int64(k);
 	}
 
 	void Int64(int64_t k)
 	{
 		if (mWriter1) mWriter1->Int64(k);
 		else if (mWriter2) mWriter2->Int64(k);
+		else if (mWriter3) mWriter3->Int64(k);
 	}
 
 	void Uint(uint32_t k)
 	{
 		if (mWriter1) mWriter1->Uint(k);
 		else if (mWriter2) mWriter2->Uint(k);
+		else if (mWriter3) mWriter3->Uint64(k);
 	}
 
 	void Uint64(int64_t k)
 	{
 		if (mWriter1) mWriter1->Uint64(k);
 		else if (mWriter2) mWriter2->Uint64(k);
+		else if (mWriter3) mWriter3->Uint64(k);
 	}
 
 	void Double(double k)
@@ -282,6 +617,10 @@ struct FWriter
 		{
 			mWriter2->Double(k);
 		}
+		else if (mWriter3)
+		{
+			mWriter3->Double(k);
+		}
 	}
 
 };
@@ -303,8 +642,15 @@ struct FReader
 
 	FReader(const char *buffer, size_t length)
 	{
-		rapidjson::Document doc;
-		mDoc.Parse(buffer, length);
+		if (FBinaryReader::IsBinary(buffer, length))
+		{
+			FBinaryReader reader(buffer, length);
+			mDoc.Populate(reader);
+		}
+		else
+		{
+			mDoc.Parse(buffer, length);
+		}
 		mObjects.Push(FJSONObject(&mDoc));
 		memset(mPlayers, -1, sizeof(mPlayers));
 	}
@@ -355,6 +701,23 @@ bool FSerializer::OpenWriter(bool pretty)
 	return true;
 }
 
+//==========================================================================
+//
+// Writes the same data as OpenWriter, but in a binary format
+// that is a lot faster to write and read.
+//
+//==========================================================================
+
+bool FSerializer::OpenBinaryWriter()
+{
+	if (w != nullptr || r != nullptr) return false;
+
+	mErrors = 0;
+	w = new FWriter(false, true);
+	BeginObject(nullptr);
+	return true;
+}
+
 //==========================================================================
 //
 //
@@ -472,6 +835,7 @@ bool FSerializer::canSkip() const
 
 void FSerializer::WriteKey(const char *key)
 {
+	if (isWriting()) w->FlushPending();
 	if (isWriting() && w->inObject())
 	{
 		assert(key != nullptr);
@@ -493,6 +857,16 @@ bool FSerializer::BeginObject(const char *name)
 {
 	if (isWriting())
 	{
+		if (w->mDeferNext && name != nullptr && w->inObject())
+		{
+			// Nothing gets written until the object's first member shows up.
+			w->mDeferNext = false;
+			w->FlushPending();
+			w->mPendingKey = name;
+			w->mPending = true;
+			w->mInObject.Push(true);
+			return true;
+		}
 		WriteKey(name);
 		w->StartObject();
 		w->mInObject.Push(true);
@@ -509,7 +883,7 @@ bool FSerializer::BeginObject(const char *name)
 			}
 			else
 			{
-				Printf(TEXTCOLOR_RED "Object expected for '%s'\n", name);
+				Printf(TEXTCOLOR_RED "Object expected for '%s'\n", name ? name : "(unnamed)");
 				mErrors++;
 				return false;
 			}
@@ -532,7 +906,13 @@ void FSerializer::EndObject()
 {
 	if (isWriting())
 	{
-		if (w->inObject())
+		if (w->mPending)
+		{
+			// nothing was stored so the object gets omitted entirely.
+			w->mPending = false;
+			w->mInObject.Pop();
+		}
+		else if (w->inObject())
 		{
 			w->EndObject();
 			w->mInObject.Pop();
@@ -872,6 +1252,21 @@ unsigned FSerializer::GetSize(const char *group)
 	return val->Size();
 }
 
+//==========================================================================
+//
+// The next object only gets written if anything gets stored in it.
+// This allows omitting unchanged entries without having to check
+// all their members up front.
+// Since the object may not get started at all, the caller must reset
+// this once the entry is done.
+//
+//==========================================================================
+
+void FSerializer::DeferObject(bool on)
+{
+	if (isWriting()) w->mDeferNext = on;
+}
+
 //==========================================================================
 //
 // gets the key pointed to by the iterator, caches its value
@@ -1043,58 +1438,31 @@ const char *FSerializer::GetOutput(unsigned *len)
 //
 //==========================================================================
 
-FCompressedBuffer FSerializer::GetCompressedOutput()
+FCompressedBuffer FSerializer::GetStoredOutput()
 {
 	if (isReading()) return{ 0,0,0,0,0,nullptr };
 	FCompressedBuffer buff;
 	WriteObjects();
 	EndObject();
-	buff.mSize = (unsigned)w->mOutString.GetSize();
+	buff.mSize = buff.mCompressedSize = (unsigned)w->mOutString.GetSize();
+	buff.mMethod = METHOD_STORED;
 	buff.mZipFlags = 0;
 	buff.mCRC32 = crc32(0, (const Bytef*)w->mOutString.GetString(), buff.mSize);
+	buff.mBuffer = new char[buff.mSize + 1];
+	memcpy(buff.mBuffer, w->mOutString.GetString(), buff.mSize + 1);
+	return buff;
+}
 
-	uint8_t *compressbuf = new uint8_t[buff.mSize+1];
-
-	z_stream stream;
-	int err;
-
-	stream.next_in = (Bytef *)w->mOutString.GetString();
-	stream.avail_in = buff.mSize;
-	stream.next_out = (Bytef*)compressbuf;
-	stream.avail_out = buff.mSize;
-	stream.zalloc = (alloc_func)0;
-	stream.zfree = (free_func)0;
-	stream.opaque = (voidpf)0;
-
-	// create output in zip-compatible form as required by FCompressedBuffer
-	err = deflateInit2(&stream, 8, Z_DEFLATED, -15, 9, Z_DEFAULT_STRATEGY);
-	if (err != Z_OK)
-	{
-		goto error;
-	}
-
-	err = deflate(&stream, Z_FINISH);
-	if (err != Z_STREAM_END) 
-	{
-		deflateEnd(&stream);
-		goto error;
-	}
-	buff.mCompressedSize = stream.total_out;
-
-	err = deflateEnd(&stream);
-	if (err == Z_OK)
-	{
-		buff.mBuffer = new char[buff.mCompressedSize];
-		buff.mMethod = METHOD_DEFLATE;
-		memcpy(buff.mBuffer, compressbuf, buff.mCompressedSize);
-		delete[] compressbuf;
-		return buff;
-	}
+//==========================================================================
+//
+//
+//
+//==========================================================================
 
-error:
-	memcpy(compressbuf, w->mOutString.GetString(), buff.mSize + 1);
-	buff.mCompressedSize = buff.mSize;
-	buff.mMethod = METHOD_STORED;
+FCompressedBuffer FSerializer::GetCompressedOutput()
+{
+	FCompressedBuffer buff = GetStoredOutput();
+	buff.Compress();
 	return buff;
 }
 
@@ -83,6 +83,7 @@ public:
 		Close();
 	}
 	bool OpenWriter(bool pretty = true);
+	bool OpenBinaryWriter();
 	bool OpenReader(const char *buffer, size_t length);
 	bool OpenReader(FCompressedBuffer *input);
 	void Close();
@@ -91,9 +92,11 @@ public:
 	void EndObject();
 	bool BeginArray(const char *name);
 	void EndArray();
+	void DeferObject(bool on = true);
 	unsigned GetSize(const char *group);
 	const char *GetKey();
 	const char *GetOutput(unsigned *len = nullptr);
+	FCompressedBuffer GetStoredOutput();
 	FCompressedBuffer GetCompressedOutput();
 	FSerializer &Args(const char *key, int *args, int *defargs, int special);
 	FSerializer &Terrain(const char *key, int &terrain, int *def = nullptr);
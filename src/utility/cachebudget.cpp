@@ -0,0 +1,62 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Memory budget for the caches of reloadable data
+//
+//-----------------------------------------------------------------------------
+
+#include "cachebudget.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "zstring.h"
+
+std::atomic<size_t> CacheResident[NUM_CACHEPOOLS];
+std::atomic<unsigned> CacheEvictions[NUM_CACHEPOOLS];
+
+// In megabytes. Off by default, since keeping unreferenced data around only pays off for mods that keep reloading the same lumps.
+CUSTOM_CVAR(Int, cache_budget, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
+{
+	if (self < 0) self = 0;
+	else TrimLumpCache();
+}
+
+size_t CacheBudget()
+{
+	return size_t(*cache_budget) << 20;
+}
+
+bool CacheOverBudget()
+{
+	size_t budget = CacheBudget();
+	if (budget == 0) return false;
+
+	size_t total = 0;
+	for (auto &bytes : CacheResident) total += bytes.load();
+	return total > budget;
+}
+
+ADD_STAT(caches)
+{
+	FString out;
+	out.Format("Lumps: %.2f MB, SW textures: %.2f MB, budget: %d MB, evicted: %u lumps, %u textures",
+		CacheResident[CACHE_Lumps].load() / (1024. * 1024.), CacheResident[CACHE_SWTextures].load() / (1024. * 1024.), *cache_budget,
+		CacheEvictions[CACHE_Lumps].load(), CacheEvictions[CACHE_SWTextures].load());
+	return out;
+}
@@ -0,0 +1,52 @@
+//-----------------------------------------------------------------------------
+//
+// Copyright 2020 GZDoom Development Team
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Memory budget for the caches of reloadable data
+//
+//-----------------------------------------------------------------------------
+
+#pragma once
+
+#include <stddef.h>
+#include <atomic>
+
+// Data that can be recreated on demand - lump caches nobody references
+// anymore and the software renderer's texture pixels - is kept around
+// until all of it together exceeds the cache_budget CVAR. After that the
+// least recently used entries are dropped first.
+// The default budget of 0 means unreferenced lumps are freed right away and
+// texture pixels are never evicted, i.e. the behavior before this existed.
+// Lumps get cached and released on worker threads as well, so the counters
+// are atomic.
+
+enum ECachePool
+{
+	CACHE_Lumps,
+	CACHE_SWTextures,
+	NUM_CACHEPOOLS
+};
+
+extern std::atomic<size_t> CacheResident[NUM_CACHEPOOLS];	// bytes currently held by each pool
+extern std::atomic<unsigned> CacheEvictions[NUM_CACHEPOOLS];
+
+size_t CacheBudget();
+bool CacheOverBudget();
+
+void TrimLumpCache();		// implemented in resourcefile.cpp
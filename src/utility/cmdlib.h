@@ -14,6 +14,7 @@
 #include <errno.h>
 #include <ctype.h>
 #include <stdarg.h>
+#include <time.h>
 
 // the dec offsetof macro doesnt work very well...
 #define myoffsetof(type,identifier) ((size_t)&((type *)alignof(type))->identifier - alignof(type))
@@ -21,6 +22,8 @@
 bool FileExists (const char *filename);
 bool DirExists(const char *filename);
 bool DirEntryExists (const char *pathname, bool *isdir = nullptr);
+bool GetFileInfo(const char *pathname, size_t *size, time_t *time);
+bool TouchFile(const char *pathname);
 
 extern	FString progdir;
 
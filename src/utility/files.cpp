@@ -33,6 +33,17 @@
 **
 */
 
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <limits.h>
+
 #include "files.h"
 #include "templates.h"
 
@@ -48,6 +59,24 @@ FILE *myfopen(const char *filename, const char *flags)
 #endif
 }
 
+//==========================================================================
+//
+// Moves a file over another one. Unlike rename on Windows this replaces an
+// existing file, which is left untouched if anything goes wrong.
+//
+//==========================================================================
+
+bool myrename(const char *from, const char *to)
+{
+#ifndef _WIN32
+	return rename(from, to) == 0;
+#else
+	auto widefrom = WideString(from);
+	auto wideto = WideString(to);
+	return !!MoveFileExW(widefrom.c_str(), wideto.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#endif
+}
+
 
 //==========================================================================
 //
@@ -347,6 +376,81 @@ public:
 };
 
 
+//==========================================================================
+//
+// MappedFileReader
+//
+// maps an entire file into memory. Since this exposes a buffer, lumps
+// that are stored uncompressed can point their cache directly into the
+// mapping, so nothing gets copied and only the parts that actually
+// get used become resident. The mapping is copy-on-write so code
+// altering a cached lump in place cannot write back to the file.
+//
+// Other programs may still replace or delete a loaded archive, just like
+// with the buffered reader. On POSIX systems truncating a mapped file while
+// it is in use raises SIGBUS on the next access to the lost pages, so
+// archives must not be rewritten in place while the game is running.
+//
+//==========================================================================
+
+class MappedFileReader : public MemoryReader
+{
+public:
+	~MappedFileReader()
+	{
+		if (bufptr != nullptr)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(bufptr);
+#else
+			munmap((void*)bufptr, Length);
+#endif
+		}
+	}
+
+	bool Open(const char *filename)
+	{
+#ifdef _WIN32
+		// Allow the same sharing as fopen so that editors and launchers can still replace the file.
+		HANDLE hFile = CreateFileW(WideString(filename).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (hFile == INVALID_HANDLE_VALUE) return false;
+
+		LARGE_INTEGER size;
+		void *mem = nullptr;
+		if (GetFileSizeEx(hFile, &size) && size.QuadPart > 0 && size.QuadPart <= LONG_MAX)
+		{
+			HANDLE hMap = CreateFileMappingW(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+			if (hMap != nullptr)
+			{
+				mem = MapViewOfFile(hMap, FILE_MAP_COPY, 0, 0, 0);
+				// The view keeps its own reference to the mapping.
+				CloseHandle(hMap);
+			}
+		}
+		CloseHandle(hFile);
+		if (mem == nullptr) return false;
+		Length = (long)size.QuadPart;
+#else
+		int fd = open(filename, O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info;
+		void *mem = MAP_FAILED;
+		if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 && info.st_size <= LONG_MAX)
+		{
+			mem = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		}
+		// The mapping stays valid after the descriptor is closed.
+		close(fd);
+		if (mem == MAP_FAILED) return false;
+		Length = (long)info.st_size;
+#endif
+		bufptr = (const char *)mem;
+		FilePos = 0;
+		return true;
+	}
+};
+
 
 //==========================================================================
 //
@@ -369,6 +473,21 @@ bool FileReader::OpenFile(const char *filename, FileReader::Size start, FileRead
 	return true;
 }
 
+bool FileReader::OpenFileMapped(const char *filename)
+{
+	auto reader = new MappedFileReader;
+	if (!reader->Open(filename))
+	{
+		// Empty files, files too large for the address space and platforms that cannot map
+		// this file still can be read the regular way.
+		delete reader;
+		return OpenFile(filename);
+	}
+	Close();
+	mReader = reader;
+	return true;
+}
+
 bool FileReader::OpenFilePart(FileReader &parent, FileReader::Size start, FileReader::Size length)
 {
 	auto reader = new FileReaderRedirect(parent, (long)start, (long)length);
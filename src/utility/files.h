@@ -50,9 +50,11 @@ enum
 	METHOD_DEFLATE = 8,
 	METHOD_BZIP2 = 12,
 	METHOD_LZMA = 14,
+	METHOD_ZSTD = 93,
 	METHOD_PPMD = 98,
 	METHOD_LZSS = 1337,	// not used in Zips - this is for Console Doom compression
 	METHOD_ZLIB = 1338,	// Zlib stream with header, used by compressed nodes.
+	METHOD_LZ4 = 1339,	// LZ4 frame. Not assigned by the zip appnote, only written by zipdir.
 };
 
 class FileReaderInterface
@@ -163,6 +165,7 @@ public:
 	}
 
 	bool OpenFile(const char *filename, Size start = 0, Size length = -1);
+	bool OpenFileMapped(const char *filename);	// map the entire file into memory so that GetBuffer can be used. Falls back to OpenFile if this fails.
 	bool OpenFilePart(FileReader &parent, Size start, Size length);
 	bool OpenMemory(const void *mem, Size length);	// read directly from the buffer
 	bool OpenMemoryArray(const void *mem, Size length);	// read from a copy of the buffer.
@@ -278,6 +281,8 @@ public:
 
 
 
+bool myrename(const char *from, const char *to);
+
 class FileWriter
 {
 protected:
@@ -37,6 +37,12 @@
 #include "LzmaDec.h"
 #include <zlib.h>
 #include <bzlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
 
 #include "files.h"
 #include "doomerrors.h"
@@ -561,6 +567,185 @@ public:
 	}
 };
 
+#ifdef HAVE_ZSTD
+//==========================================================================
+//
+// DecompressorZstd
+//
+// The zstd wrapper
+// reads data from a Zstandard compressed stream (zip method 93)
+//
+//==========================================================================
+
+class DecompressorZstd : public DecompressorBase
+{
+	enum { BUFF_SIZE = 4096 };
+
+	FileReader &File;
+	bool SawEOF;
+	ZSTD_DStream *Stream;
+	ZSTD_inBuffer In;
+	uint8_t InBuff[BUFF_SIZE];
+
+public:
+	DecompressorZstd (FileReader &file)
+	: File(file), SawEOF(false)
+	{
+		Stream = ZSTD_createDStream();
+		if (Stream == nullptr)
+		{
+			I_Error ("DecompressorZstd: ZSTD_createDStream failed\n");
+		}
+
+		size_t err = ZSTD_initDStream(Stream);
+		if (ZSTD_isError(err))
+		{
+			ZSTD_freeDStream(Stream);
+			I_Error ("DecompressorZstd: ZSTD_initDStream failed: %s\n", ZSTD_getErrorName(err));
+		}
+
+		FillBuffer ();
+	}
+
+	~DecompressorZstd ()
+	{
+		ZSTD_freeDStream (Stream);
+	}
+
+	long Read (void *buffer, long len) override
+	{
+		ZSTD_outBuffer out = { buffer, (size_t)len, 0 };
+		size_t err;
+
+		do
+		{
+			size_t lastpos = out.pos;
+
+			err = ZSTD_decompressStream(Stream, &out, &In);
+			if (ZSTD_isError(err))
+			{
+				I_Error ("Corrupt zstd stream: %s", ZSTD_getErrorName(err));
+			}
+			if (In.pos == In.size)
+			{
+				if (!SawEOF) FillBuffer ();
+				else if (out.pos == lastpos) break;	// nothing left to flush
+			}
+		} while (err != 0 && out.pos < out.size);
+
+		if (out.pos != out.size)
+		{
+			I_Error ("Ran out of data in zstd stream");
+		}
+
+		return len;
+	}
+
+	void FillBuffer ()
+	{
+		auto numread = File.Read (InBuff, BUFF_SIZE);
+
+		if (numread < BUFF_SIZE)
+		{
+			SawEOF = true;
+		}
+		In.src = InBuff;
+		In.size = (size_t)numread;
+		In.pos = 0;
+	}
+};
+#endif
+
+#ifdef HAVE_LZ4
+//==========================================================================
+//
+// DecompressorLZ4
+//
+// The lz4 wrapper
+// reads data from an LZ4 frame, as written by zipdir
+//
+//==========================================================================
+
+class DecompressorLZ4 : public DecompressorBase
+{
+	enum { BUFF_SIZE = 4096 };
+
+	FileReader &File;
+	bool SawEOF;
+	LZ4F_dctx *Context;
+	size_t InPos, InSize;
+	uint8_t InBuff[BUFF_SIZE];
+
+public:
+	DecompressorLZ4 (FileReader &file)
+	: File(file), SawEOF(false)
+	{
+		LZ4F_errorCode_t err = LZ4F_createDecompressionContext(&Context, LZ4F_VERSION);
+		if (LZ4F_isError(err))
+		{
+			I_Error ("DecompressorLZ4: LZ4F_createDecompressionContext failed: %s\n", LZ4F_getErrorName(err));
+		}
+
+		FillBuffer ();
+	}
+
+	~DecompressorLZ4 ()
+	{
+		LZ4F_freeDecompressionContext (Context);
+	}
+
+	long Read (void *buffer, long len) override
+	{
+		uint8_t *Out = (uint8_t *)buffer;
+		size_t AvailOut = len;
+
+		while (AvailOut > 0)
+		{
+			size_t outsize = AvailOut;
+			size_t insize = InSize - InPos;
+
+			size_t err = LZ4F_decompress(Context, Out, &outsize, InBuff + InPos, &insize, nullptr);
+			if (LZ4F_isError(err))
+			{
+				I_Error ("Corrupt LZ4 stream: %s", LZ4F_getErrorName(err));
+			}
+			InPos += insize;
+			Out += outsize;
+			AvailOut -= outsize;
+
+			if (err == 0)
+			{
+				break;	// end of frame
+			}
+			if (InPos == InSize)
+			{
+				if (!SawEOF) FillBuffer ();
+				else if (outsize == 0) break;	// nothing left to flush
+			}
+		}
+
+		if (AvailOut != 0)
+		{
+			I_Error ("Ran out of data in LZ4 stream");
+		}
+
+		return len;
+	}
+
+	void FillBuffer ()
+	{
+		auto numread = File.Read (InBuff, BUFF_SIZE);
+
+		if (numread < BUFF_SIZE)
+		{
+			SawEOF = true;
+		}
+		InPos = 0;
+		InSize = (size_t)numread;
+	}
+};
+#endif
+
 
 bool FileReader::OpenDecompressor(FileReader &parent, Size length, int method, bool seekable)
 {
@@ -583,6 +768,18 @@ bool FileReader::OpenDecompressor(FileReader &parent, Size length, int method, b
 		case METHOD_LZSS:
 			dec = new DecompressorLZSS(parent);
 			break;
+
+#ifdef HAVE_ZSTD
+		case METHOD_ZSTD:
+			dec = new DecompressorZstd(parent);
+			break;
+#endif
+
+#ifdef HAVE_LZ4
+		case METHOD_LZ4:
+			dec = new DecompressorLZ4(parent);
+			break;
+#endif
 			
 		// todo: METHOD_IMPLODE, METHOD_SHRINK
 		default:
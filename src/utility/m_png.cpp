@@ -39,6 +39,10 @@
 #ifdef _MSC_VER
 #include <malloc.h>		// for alloca()
 #endif
+#if !defined(NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define PNG_SSE2
+#endif
 
 #include "m_crc32.h"
 #include "m_swap.h"
@@ -1049,6 +1053,105 @@ static bool WriteIDAT (FileWriter *file, const uint8_t *data, int len)
 	return true;
 }
 
+#ifdef PNG_SSE2
+//==========================================================================
+//
+// SSE2 unfilter kernels
+//
+// Sub, Average and Paeth depend on the previous pixel, so these process
+// one pixel of 2-4 bytes per step, with all channels in parallel. Up has
+// no such dependency and works on 16 bytes at a time. The results are
+// identical to the scalar code in UnfilterRow.
+//
+//==========================================================================
+
+template<int bpp> static inline __m128i LoadPixel(const uint8_t *p)
+{
+	uint32_t v = 0;
+	memcpy(&v, p, bpp);
+	return _mm_cvtsi32_si128(v);
+}
+
+template<int bpp> static inline void StorePixel(uint8_t *p, __m128i v)
+{
+	uint32_t o = _mm_cvtsi128_si32(v);
+	memcpy(p, &o, bpp);
+}
+
+template<int bpp> static void UnfilterSub_SSE2(int width, uint8_t *dest, const uint8_t *row)
+{
+	__m128i a = _mm_setzero_si128();
+	for (int x = 0; x < width; x += bpp)
+	{
+		a = _mm_add_epi8(a, LoadPixel<bpp>(row + x));
+		StorePixel<bpp>(dest + x, a);
+	}
+}
+
+static void UnfilterUp_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i r = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i b = _mm_loadu_si128((const __m128i *)(prev + x));
+		_mm_storeu_si128((__m128i *)(dest + x), _mm_add_epi8(r, b));
+	}
+	for (; x < width; x++)
+	{
+		dest[x] = row[x] + prev[x];
+	}
+}
+
+template<int bpp> static void UnfilterAverage_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	__m128i a = _mm_setzero_si128();
+	for (int x = 0; x < width; x += bpp)
+	{
+		__m128i b = LoadPixel<bpp>(prev + x);
+		// _mm_avg_epu8 rounds up, PNG rounds down.
+		__m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+		a = _mm_add_epi8(avg, LoadPixel<bpp>(row + x));
+		StorePixel<bpp>(dest + x, a);
+	}
+}
+
+static inline __m128i Abs16_SSE2(__m128i x)
+{
+	__m128i neg = _mm_srai_epi16(x, 15);
+	return _mm_sub_epi16(_mm_xor_si128(x, neg), neg);
+}
+
+static inline __m128i Select_SSE2(__m128i mask, __m128i t, __m128i e)
+{
+	return _mm_or_si128(_mm_and_si128(mask, t), _mm_andnot_si128(mask, e));
+}
+
+template<int bpp> static void UnfilterPaeth_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero, c = zero;
+	for (int x = 0; x < width; x += bpp)
+	{
+		__m128i b = _mm_unpacklo_epi8(LoadPixel<bpp>(prev + x), zero);
+		__m128i d = _mm_unpacklo_epi8(LoadPixel<bpp>(row + x), zero);
+		__m128i pa = _mm_sub_epi16(b, c);
+		__m128i pb = _mm_sub_epi16(a, c);
+		__m128i pc = Abs16_SSE2(_mm_add_epi16(pa, pb));
+		pa = Abs16_SSE2(pa);
+		pb = Abs16_SSE2(pb);
+		__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+		__m128i pred = Select_SSE2(_mm_cmpeq_epi16(pa, smallest), a, Select_SSE2(_mm_cmpeq_epi16(pb, smallest), b, c));
+		// Adding bytewise keeps the sum of each channel in the low byte of its 16 bit lane.
+		d = _mm_add_epi8(d, pred);
+		StorePixel<bpp>(dest + x, _mm_packus_epi16(d, d));
+		a = d;
+		c = b;
+	}
+}
+#endif
+
 //==========================================================================
 //
 // UnfilterRow
@@ -1063,6 +1166,26 @@ void UnfilterRow (int width, uint8_t *dest, uint8_t *row, uint8_t *prev, int bpp
 {
 	int x;
 
+#ifdef PNG_SSE2
+	switch (*row * 8 + bpp)
+	{
+	case 1 * 8 + 2:	UnfilterSub_SSE2<2>(width, dest, row + 1);			return;
+	case 1 * 8 + 3:	UnfilterSub_SSE2<3>(width, dest, row + 1);			return;
+	case 1 * 8 + 4:	UnfilterSub_SSE2<4>(width, dest, row + 1);			return;
+	case 2 * 8 + 1:
+	case 2 * 8 + 2:
+	case 2 * 8 + 3:
+	case 2 * 8 + 4:	UnfilterUp_SSE2(width, dest, row + 1, prev);			return;
+	case 3 * 8 + 2:	UnfilterAverage_SSE2<2>(width, dest, row + 1, prev);	return;
+	case 3 * 8 + 3:	UnfilterAverage_SSE2<3>(width, dest, row + 1, prev);	return;
+	case 3 * 8 + 4:	UnfilterAverage_SSE2<4>(width, dest, row + 1, prev);	return;
+	case 4 * 8 + 2:	UnfilterPaeth_SSE2<2>(width, dest, row + 1, prev);		return;
+	case 4 * 8 + 3:	UnfilterPaeth_SSE2<3>(width, dest, row + 1, prev);		return;
+	case 4 * 8 + 4:	UnfilterPaeth_SSE2<4>(width, dest, row + 1, prev);		return;
+	default:		break;
+	}
+#endif
+
 	switch (*row++)
 	{
 	case 1:		// Sub
@@ -43,11 +43,16 @@
 
 #include "doomdata.h"
 #include "nodebuild.h"
+#include "parallel_for.h"
 
 const int MaxSegs = 64;
 const int SplitCost = 8;
 const int AAPreference = 16;
 
+// Splitter candidates are only scored on multiple threads if the number of
+// candidates times the size of the set exceeds this.
+const unsigned int MinParallelSplitterWork = 32768;
+
 #if 0
 #define D(x) x
 #else
@@ -104,8 +109,6 @@ void FNodeBuilder::Clear()
 	SegList.Clear();
 	PlaneChecked.Clear();
 	Planes.Clear();
-	Touched.Clear();
-	Colinear.Clear();
 	SplitSharers.Clear();
 	if (VertexMap == NULL)
 	{
@@ -444,6 +447,7 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	int bestvalue;
 	uint32_t bestseg;
 	uint32_t seg;
+	unsigned int setsize;
 	bool nosplitters = false;
 
 	bestvalue = 0;
@@ -451,11 +455,16 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 
 	seg = set;
 	stepleft = 0;
+	setsize = 0;
 
 	memset (&PlaneChecked[0], 0, PlaneChecked.Size());
+	SplitterCandidates.Clear();
+	SplitterBatch.Fill (*this, set);
 
 	D(Printf (PRINT_LOG, "Processing set %d\n", set));
 
+	// Collect the candidates first. Scoring them does not modify anything,
+	// so large sets can be scored in parallel.
 	while (seg != UINT_MAX)
 	{
 		FPrivSeg *pseg = &Segs[seg];
@@ -473,26 +482,52 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 				}
 
 				stepleft = step;
-				SetNodeFromSeg (node, pseg);
+				SplitterCandidates.Push(seg);
+			}
+		}
 
-				int value = Heuristic (node, set, nosplit);
+		seg = pseg->next;
+		setsize++;
+	}
 
-				D(Printf (PRINT_LOG, "Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", seg, Segs[seg].linedef, node.x>>16, node.y>>16,
-					(node.x+node.dx)>>16, (node.y+node.dy)>>16, value));
+	const unsigned int numcandidates = SplitterCandidates.Size();
+	SplitterScores.Resize(numcandidates);
 
-				if (value > bestvalue)
-				{
-					bestvalue = value;
-					bestseg = seg;
-				}
-				else if (value < 0)
-				{
-					nosplitters = true;
-				}
-			}
+	if (numcandidates > 1 && numcandidates * setsize >= MinParallelSplitterWork)
+	{
+		parallel_for((int)numcandidates, [&](int i)
+		{
+			node_t testnode;
+			FSplitterScratch scratch;
+			SetNodeFromSeg (testnode, &Segs[SplitterCandidates[i]]);
+			SplitterScores[i] = Heuristic (testnode, SplitterBatch, nosplit, scratch);
+		});
+	}
+	else
+	{
+		for (unsigned int i = 0; i < numcandidates; i++)
+		{
+			SetNodeFromSeg (node, &Segs[SplitterCandidates[i]]);
+			SplitterScores[i] = Heuristic (node, SplitterBatch, nosplit, SplitterScratch);
 		}
+	}
 
-		seg = pseg->next;
+	// Pick the winner in set order so that the result does not depend on how the scoring was done.
+	for (unsigned int i = 0; i < numcandidates; i++)
+	{
+		int value = SplitterScores[i];
+
+		D(Printf (PRINT_LOG, "Seg %5d, ld %d scores %d\n", SplitterCandidates[i], Segs[SplitterCandidates[i]].linedef, value));
+
+		if (value > bestvalue)
+		{
+			bestvalue = value;
+			bestseg = SplitterCandidates[i];
+		}
+		else if (value < 0)
+		{
+			nosplitters = true;
+		}
 	}
 
 	if (bestseg == UINT_MAX)
@@ -515,6 +550,12 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 // in the set.
 
 int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
+{
+	SplitterBatch.Fill (*this, set);
+	return Heuristic (node, SplitterBatch, honorNoSplit, SplitterScratch);
+}
+
+int FNodeBuilder::Heuristic (node_t &node, const FSplitterBatch &batch, bool honorNoSplit, FSplitterScratch &scratch) const
 {
 	// Set the initial score above 0 so that near vertex anti-weighting is less likely to produce a negative score.
 	int score = 1000000;
@@ -522,27 +563,41 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	int counts[2] = { 0, 0 };
 	int realSegs[2] = { 0, 0 };
 	int specialSegs[2] = { 0, 0 };
-	uint32_t i = set;
-	int sidev[2];
+	const unsigned int numsegs = batch.Seg.Size();
+	int sidev[2] = { 0, 0 };
 	int side;
 	bool splitter = false;
 	unsigned int max, m2, p, q;
 	double frac;
 
-	Touched.Clear ();
-	Colinear.Clear ();
+	TArray<int> &touched = scratch.Touched;
+	TArray<int> &colinear = scratch.Colinear;
+	touched.Clear ();
+	colinear.Clear ();
+
+	scratch.Sides.Resize (numsegs * 2);
+	ClassifySegs (node, batch, scratch.Sides.Data());
 
-	while (i != UINT_MAX)
+	for (unsigned int k = 0; k < numsegs; ++k)
 	{
-		const FPrivSeg *test = &Segs[i];
+		const uint32_t i = batch.Seg[k];
+		const int loopnum = batch.LoopNum[k];
+		const uint8_t flags = batch.Flags[k];
 
 		if (HackSeg == i)
 		{
+			// Like the scalar code, this does not classify the seg, so sidev
+			// keeps the values of the previous seg for the nosplit check below.
 			side = 1;
 		}
 		else
 		{
-			side = ClassifyLine (node, &Vertices[test->v1], &Vertices[test->v2], sidev);
+			sidev[0] = scratch.Sides[k * 2];
+			sidev[1] = scratch.Sides[k * 2 + 1];
+			side = batch.SideFromVertices (node, k, sidev);
+#ifdef _DEBUG
+			CheckBatchClassification (node, batch, k, side, sidev);
+#endif
 		}
 		switch (side)
 		{
@@ -552,45 +607,45 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 			// The "right" thing to do in this case is to only reject it if there is
 			// another nosplit seg from the same sector at this vertex. Note that a line
 			// that lies exactly on top of the splitter is okay.
-			if (test->loopnum && honorNoSplit && (sidev[0] == 0 || sidev[1] == 0))
+			if (loopnum && honorNoSplit && (sidev[0] == 0 || sidev[1] == 0))
 			{
 				if ((sidev[0] | sidev[1]) != 0)
 				{
-					max = Touched.Size();
+					max = touched.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Touched[p] == test->loopnum)
+						if (touched[p] == loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Touched.Push (test->loopnum);
+						touched.Push (loopnum);
 					}
 				}
 				else
 				{
-					max = Colinear.Size();
+					max = colinear.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Colinear[p] == test->loopnum)
+						if (colinear[p] == loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Colinear.Push (test->loopnum);
+						colinear.Push (loopnum);
 					}
 				}
 			}
 
 			counts[side]++;
-			if (test->linedef != -1)
+			if (flags & FSplitterBatch::SEG_Real)
 			{
 				realSegs[side]++;
-				if (test->frontsector == test->backsector)
+				if (flags & FSplitterBatch::SEG_Special)
 				{
 					specialSegs[side]++;
 				}
@@ -606,7 +661,7 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 
 		default:	// Seg is cut by the partition
 			// If we are not allowed to split this seg, reject this splitter
-			if (test->loopnum)
+			if (loopnum)
 			{
 				if (honorNoSplit)
 				{
@@ -620,20 +675,20 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 			}
 
 			// Splitters that are too close to a vertex are bad.
-			frac = InterceptVector (node, *test);
+			frac = batch.InterceptVector (node, k);
 			if (frac < 0.001 || frac > 0.999)
 			{
-				FPrivVert *v1 = &Vertices[test->v1];
-				FPrivVert *v2 = &Vertices[test->v2];
-				double x = v1->x, y = v1->y;
-				x += frac * (v2->x - x);
-				y += frac * (v2->y - y);
-				if (fabs(x - v1->x) < VERTEX_EPSILON+1 && fabs(y - v1->y) < VERTEX_EPSILON+1)
+				const double x1 = batch.X1[k], y1 = batch.Y1[k];
+				const double x2 = batch.X2[k], y2 = batch.Y2[k];
+				double x = x1, y = y1;
+				x += frac * (x2 - x);
+				y += frac * (y2 - y);
+				if (fabs(x - x1) < VERTEX_EPSILON+1 && fabs(y - y1) < VERTEX_EPSILON+1)
 				{
 					D(Printf("Splitter will produce same start vertex as seg %d\n", i));
 					return -1;
 				}
-				if (fabs(x - v2->x) < VERTEX_EPSILON+1 && fabs(y - v2->y) < VERTEX_EPSILON+1)
+				if (fabs(x - x2) < VERTEX_EPSILON+1 && fabs(y - y2) < VERTEX_EPSILON+1)
 				{
 					D(Printf("Splitter will produce same end vertex as seg %d\n", i));
 					return -1;
@@ -649,11 +704,11 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 
 			counts[0]++;
 			counts[1]++;
-			if (test->linedef != -1)
+			if (flags & FSplitterBatch::SEG_Real)
 			{
 				realSegs[0]++;
 				realSegs[1]++;
-				if (test->frontsector == test->backsector)
+				if (flags & FSplitterBatch::SEG_Special)
 				{
 					specialSegs[0]++;
 					specialSegs[1]++;
@@ -663,7 +718,6 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 		}
 
 		segsInSet++;
-		i = test->next;
 	}
 
 	// If this line is outside all the others, return a special score
@@ -698,8 +752,8 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	// seg of that sector must be crossing the container's corner and does not
 	// actually split the container.
 
-	max = Touched.Size ();
-	m2 = Colinear.Size ();
+	max = touched.Size ();
+	m2 = colinear.Size ();
 
 	// If honorNoSplit is false, then both these lists will be empty.
 
@@ -712,10 +766,10 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 
 	for (p = 0; p < max; ++p)
 	{
-		int look = Touched[p];
+		int look = touched[p];
 		for (q = 0; q < m2; ++q)
 		{
-			if (look == Colinear[q])
+			if (look == colinear[q])
 			{
 				break;
 			}
@@ -1033,7 +1087,7 @@ void FNodeBuilder::RemoveSegFromVert2 (uint32_t segnum, int vertnum)
 	}
 }
 
-double FNodeBuilder::InterceptVector (const node_t &splitter, const FPrivSeg &seg)
+double FNodeBuilder::InterceptVector (const node_t &splitter, const FPrivSeg &seg) const
 {
 	double v2x = (double)Vertices[seg.v1].x;
 	double v2y = (double)Vertices[seg.v1].y;
@@ -145,6 +145,34 @@ class FNodeBuilder
 		uint32_t Partner;
 	};
 
+	// The segs of a set, copied into flat arrays so that splitters can be
+	// scored without walking the seg list and looking up vertices each time.
+	struct FSplitterBatch
+	{
+		enum
+		{
+			SEG_Real = 1,		// not a miniseg
+			SEG_Special = 2,	// same sector on both sides
+		};
+
+		TArray<uint32_t> Seg;
+		TArray<double> X1, Y1, X2, Y2;
+		TArray<int> LoopNum;
+		TArray<uint8_t> Flags;
+
+		void Fill (const FNodeBuilder &builder, uint32_t set);
+		int SideFromVertices (const node_t &node, unsigned int k, const int sidev[2]) const;
+		double InterceptVector (const node_t &splitter, unsigned int k) const;
+	};
+
+	// Per thread working memory for Heuristic
+	struct FSplitterScratch
+	{
+		TArray<int> Touched;	// Loops a splitter touches on a vertex
+		TArray<int> Colinear;	// Loops with edges colinear to a splitter
+		TArray<int8_t> Sides;	// Side of each seg vertex
+	};
+
 
 	// Like a blockmap, but for vertices instead of lines
 	class IVertexMap
@@ -265,12 +293,15 @@ private:
 	TArray<uint8_t> PlaneChecked;
 	TArray<FSimpleLine> Planes;
 
-	TArray<int> Touched;	// Loops a splitter touches on a vertex
-	TArray<int> Colinear;	// Loops with edges colinear to a splitter
 	FEventTree Events;		// Vertices intersected by the current splitter
 
 	TArray<FSplitSharer> SplitSharers;	// Segs colinear with the current splitter
 
+	TArray<uint32_t> SplitterCandidates;	// Segs SelectSplitter is going to score
+	TArray<int> SplitterScores;
+	FSplitterBatch SplitterBatch;
+	FSplitterScratch SplitterScratch;
+
 	uint32_t HackSeg;			// Seg to force to back of splitter
 	uint32_t HackMate;			// Seg to use in front of hack seg
 	FLevel &Level;
@@ -298,13 +329,21 @@ private:
 	void SplitSegs (uint32_t set, node_t &node, uint32_t splitseg, uint32_t &outset0, uint32_t &outset1, unsigned int &count0, unsigned int &count1);
 	uint32_t SplitSeg (uint32_t segnum, int splitvert, int v1InFront);
 	int Heuristic (node_t &node, uint32_t set, bool honorNoSplit);
+	int Heuristic (node_t &node, const FSplitterBatch &batch, bool honorNoSplit, FSplitterScratch &scratch) const;
 
 	// Returns:
 	//	0 = seg is in front
 	//  1 = seg is in back
 	// -1 = seg cuts the node
 
-	int ClassifyLine (node_t &node, const FPrivVert *v1, const FPrivVert *v2, int sidev[2]);
+	int ClassifyLine (node_t &node, const FPrivVert *v1, const FPrivVert *v2, int sidev[2]) const;
+
+	// Classifies both vertices of every seg in the batch like ClassifyLine does.
+	static void ClassifySegs (const node_t &node, const FSplitterBatch &batch, int8_t *sidev);
+#ifdef _DEBUG
+	// Asserts that the batch classified a seg exactly like the scalar code does.
+	void CheckBatchClassification (node_t &node, const FSplitterBatch &batch, unsigned int k, int side, const int sidev[2]) const;
+#endif
 
 	void FixSplitSharers (const node_t &node);
 	double AddIntersection (const node_t &node, int vertex);
@@ -323,7 +362,7 @@ private:
 
 	static int SortSegs (const void *a, const void *b);
 
-	double InterceptVector (const node_t &splitter, const FPrivSeg &seg);
+	double InterceptVector (const node_t &splitter, const FPrivSeg &seg) const;
 
 	void PrintSet (int l, uint32_t set);
 
@@ -0,0 +1,160 @@
+#include <math.h>
+#include <assert.h>
+
+#include "doomtype.h"
+#include "nodebuild.h"
+
+#if !defined(NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define NODEBUILD_SSE2
+#endif
+
+#define FAR_ENOUGH 17179869184.f		// 4<<32
+
+// Splitter scoring looks at the same set of segs once for every candidate,
+// so the segs' data is gathered once per set and then classified in bulk.
+// The results must be exactly the same as ClassifyLine's, or the generated
+// nodes would change.
+
+void FNodeBuilder::FSplitterBatch::Fill (const FNodeBuilder &builder, uint32_t set)
+{
+	Seg.Clear();
+	X1.Clear();
+	Y1.Clear();
+	X2.Clear();
+	Y2.Clear();
+	LoopNum.Clear();
+	Flags.Clear();
+
+	for (; set != UINT_MAX; set = builder.Segs[set].next)
+	{
+		const FPrivSeg *seg = &builder.Segs[set];
+		const FPrivVert *v1 = &builder.Vertices[seg->v1];
+		const FPrivVert *v2 = &builder.Vertices[seg->v2];
+
+		Seg.Push(set);
+		X1.Push(double(v1->x));
+		Y1.Push(double(v1->y));
+		X2.Push(double(v2->x));
+		Y2.Push(double(v2->y));
+		LoopNum.Push(seg->loopnum);
+		Flags.Push(uint8_t((seg->linedef != -1 ? SEG_Real : 0) | (seg->frontsector == seg->backsector ? SEG_Special : 0)));
+	}
+}
+
+// Returns the same as ClassifyLine, given the sides of the seg's vertices.
+
+int FNodeBuilder::FSplitterBatch::SideFromVertices (const node_t &node, unsigned int k, const int sidev[2]) const
+{
+	if ((sidev[0] | sidev[1]) == 0)
+	{ // seg is coplanar with the splitter, so use its orientation to determine
+	  // which child it ends up in. If it faces the same direction as the splitter,
+	  // it goes in front. Otherwise, it goes in back.
+
+		if (node.dx != 0)
+		{
+			return ((node.dx > 0 && X2[k] > X1[k]) || (node.dx < 0 && X2[k] < X1[k])) ? 0 : 1;
+		}
+		else
+		{
+			return ((node.dy > 0 && Y2[k] > Y1[k]) || (node.dy < 0 && Y2[k] < Y1[k])) ? 0 : 1;
+		}
+	}
+	else if (sidev[0] <= 0 && sidev[1] <= 0)
+	{
+		return 0;
+	}
+	else if (sidev[0] >= 0 && sidev[1] >= 0)
+	{
+		return 1;
+	}
+	return -1;
+}
+
+double FNodeBuilder::FSplitterBatch::InterceptVector (const node_t &splitter, unsigned int k) const
+{
+	double v2x = X1[k];
+	double v2y = Y1[k];
+	double v2dx = X2[k] - v2x;
+	double v2dy = Y2[k] - v2y;
+	double v1dx = (double)splitter.dx;
+	double v1dy = (double)splitter.dy;
+
+	double den = v1dy*v2dx - v1dx*v2dy;
+
+	if (den == 0.0)
+		return 0;		// parallel
+
+	double v1x = (double)splitter.x;
+	double v1y = (double)splitter.y;
+
+	double num = (v1x - v2x)*v1dy + (v2y - v1y)*v1dx;
+	double frac = num / den;
+
+	return frac;
+}
+
+static inline int8_t PointSide (double s_num, double l)
+{
+	if (fabs(s_num) < FAR_ENOUGH && s_num * s_num * l < SIDE_EPSILON*SIDE_EPSILON)
+	{
+		return 0;
+	}
+	return s_num > 0.0 ? -1 : 1;
+}
+
+#ifdef NODEBUILD_SSE2
+// Does two points at a time and writes their sides to every other entry of sidev.
+static inline void PointSides_SSE2 (const double *x, const double *y, __m128d x1, __m128d y1, __m128d dx, __m128d dy, __m128d l, int8_t *sidev)
+{
+	const __m128d zero = _mm_setzero_pd();
+	__m128d s_num = _mm_sub_pd(_mm_mul_pd(_mm_sub_pd(y1, _mm_loadu_pd(y)), dx), _mm_mul_pd(_mm_sub_pd(x1, _mm_loadu_pd(x)), dy));
+	__m128d isnear = _mm_cmplt_pd(_mm_andnot_pd(_mm_set1_pd(-0.0), s_num), _mm_set1_pd(FAR_ENOUGH));
+	isnear = _mm_and_pd(isnear, _mm_cmplt_pd(_mm_mul_pd(_mm_mul_pd(s_num, s_num), l), _mm_set1_pd(SIDE_EPSILON*SIDE_EPSILON)));
+	int nearmask = _mm_movemask_pd(isnear);
+	int frontmask = _mm_movemask_pd(_mm_cmpgt_pd(s_num, zero));
+	sidev[0] = (nearmask & 1) ? 0 : (frontmask & 1) ? -1 : 1;
+	sidev[2] = (nearmask & 2) ? 0 : (frontmask & 2) ? -1 : 1;
+}
+#endif
+
+void FNodeBuilder::ClassifySegs (const node_t &node, const FSplitterBatch &batch, int8_t *sidev)
+{
+	const unsigned int count = batch.Seg.Size();
+	const double d_x1 = double(node.x);
+	const double d_y1 = double(node.y);
+	const double d_dx = double(node.dx);
+	const double d_dy = double(node.dy);
+	const double l = 1.f / (d_dx*d_dx + d_dy*d_dy);
+	unsigned int k = 0;
+
+#ifdef NODEBUILD_SSE2
+	const __m128d x1 = _mm_set1_pd(d_x1), y1 = _mm_set1_pd(d_y1);
+	const __m128d dx = _mm_set1_pd(d_dx), dy = _mm_set1_pd(d_dy);
+	const __m128d ll = _mm_set1_pd(l);
+
+	for (; k + 2 <= count; k += 2)
+	{
+		PointSides_SSE2(&batch.X1[k], &batch.Y1[k], x1, y1, dx, dy, ll, &sidev[k * 2]);
+		PointSides_SSE2(&batch.X2[k], &batch.Y2[k], x1, y1, dx, dy, ll, &sidev[k * 2 + 1]);
+	}
+#endif
+
+	for (; k < count; ++k)
+	{
+		sidev[k * 2] = PointSide((d_y1 - batch.Y1[k]) * d_dx - (d_x1 - batch.X1[k]) * d_dy, l);
+		sidev[k * 2 + 1] = PointSide((d_y1 - batch.Y2[k]) * d_dx - (d_x1 - batch.X2[k]) * d_dy, l);
+	}
+}
+
+#ifdef _DEBUG
+void FNodeBuilder::CheckBatchClassification (node_t &node, const FSplitterBatch &batch, unsigned int k, int side, const int sidev[2]) const
+{
+	const FPrivSeg *seg = &Segs[batch.Seg[k]];
+	int checkv[2];
+	int checkside = ClassifyLine (node, &Vertices[seg->v1], &Vertices[seg->v2], checkv);
+	assert (checkside == side);
+	assert (checkv[0] == sidev[0] && checkv[1] == sidev[1]);
+	assert (side != -1 || InterceptVector (node, *seg) == batch.InterceptVector (node, k));
+}
+#endif
@@ -44,9 +44,15 @@ inline void parallel_for(const Index first, const Index last, const Index step,
 {
 	const dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
 
-	dispatch_apply((last - first) / step + 1, queue, ^(size_t slice)
+	if (last <= first)
 	{
-		function(slice * step);
+		return;
+	}
+
+	// Same number of iterations as the generic loop: i = first; i < last; i += step
+	dispatch_apply((last - first + step - 1) / step, queue, ^(size_t slice)
+	{
+		function(first + slice * step);
 	});
 }
 
@@ -180,6 +180,7 @@ FScanner &FScanner::operator=(const FScanner &other)
 	ScriptOpen = true;
 	ScriptName = other.ScriptName;
 	ScriptBuffer = other.ScriptBuffer;
+	ScriptData = other.ScriptData;
 	ScriptPtr = other.ScriptPtr;
 	ScriptEndPtr = other.ScriptEndPtr;
 	AlreadyGot = other.AlreadyGot;
@@ -187,6 +188,15 @@ FScanner &FScanner::operator=(const FScanner &other)
 	LastGotToken = other.LastGotToken;
 	LastGotPtr = other.LastGotPtr;
 	LastGotLine = other.LastGotLine;
+	if (ScriptData.Size() > 0)
+	{
+		// Unlike the string, the data is not shared so the pointers must be moved to the copy.
+		auto base = (const char *)ScriptData.Data();
+		auto otherbase = (const char *)other.ScriptData.Data();
+		ScriptPtr = base + (other.ScriptPtr - otherbase);
+		ScriptEndPtr = base + (other.ScriptEndPtr - otherbase);
+		if (LastGotPtr != NULL) LastGotPtr = base + (other.LastGotPtr - otherbase);
+	}
 	CMode = other.CMode;
 	Escape = other.Escape;
 	StateMode = other.StateMode;
@@ -273,6 +283,24 @@ void FScanner::OpenMem (const char *name, const char *buffer, int size)
 	OpenString(name, FString(buffer, size));
 }
 
+//==========================================================================
+//
+// FScanner :: OpenMem
+//
+// Takes over the buffer instead of copying it, which matters for big
+// scripts like UDMF text maps.
+//
+//==========================================================================
+
+void FScanner::OpenMem (const char *name, TArray<uint8_t> &&buffer)
+{
+	Close ();
+	ScriptData = std::move(buffer);
+	ScriptName = name;
+	LumpNum = -1;
+	PrepareScript ();
+}
+
 //==========================================================================
 //
 // FScanner :: OpenString
@@ -322,7 +350,16 @@ void FScanner::PrepareScript ()
 {
 	// The scanner requires the file to end with a '\n', so add one if
 	// it doesn't already.
-	if (ScriptBuffer.Len() == 0 || ScriptBuffer.Back() != '\n')
+	if (ScriptData.Size() > 0)
+	{
+		if (ScriptData.Last() == '\0') ScriptData.Last() = '\n';
+		else if (ScriptData.Last() != '\n') ScriptData.Push('\n');
+		// The generated scanner may look past the end, so it must be terminated like a string.
+		ScriptData.Push('\0');
+		ScriptPtr = (const char *)ScriptData.Data();
+		ScriptEndPtr = ScriptPtr + ScriptData.Size() - 1;
+	}
+	else if (ScriptBuffer.Len() == 0 || ScriptBuffer.Back() != '\n')
 	{
 		// If the last character in the buffer is a null character, change
 		// it to a newline. Otherwise, append a newline to the end.
@@ -337,8 +374,11 @@ void FScanner::PrepareScript ()
 		}
 	}
 
-	ScriptPtr = &ScriptBuffer[0];
-	ScriptEndPtr = &ScriptBuffer[ScriptBuffer.Len()];
+	if (ScriptData.Size() == 0)
+	{
+		ScriptPtr = &ScriptBuffer[0];
+		ScriptEndPtr = &ScriptBuffer[ScriptBuffer.Len()];
+	}
 	Line = 1;
 	End = false;
 	ScriptOpen = true;
@@ -365,6 +405,7 @@ void FScanner::Close ()
 {
 	ScriptOpen = false;
 	ScriptBuffer = "";
+	ScriptData.Reset();
 	BigStringBuffer = "";
 	StringBuffer[0] = '\0';
 	String = StringBuffer;
@@ -430,9 +471,11 @@ void FScanner::RestorePos (const FScanner::SavedPos &pos)
 
 bool FScanner::isText()
 {
-	for(unsigned int i=0;i<ScriptBuffer.Len();i++)
+	const char *text = ScriptData.Size() > 0 ? (const char *)ScriptData.Data() : ScriptBuffer.GetChars();
+	size_t length = ScriptData.Size() > 0 ? ScriptData.Size() - 1 : ScriptBuffer.Len();
+	for(size_t i=0;i<length;i++)
 	{
-		int c = ScriptBuffer[i];
+		int c = text[i];
 		if (c < ' ' && c != '\n' && c != '\r' && c != '\t') return false;
 	}
 	return true;
@@ -27,6 +27,7 @@ public:
 	{
 		OpenMem(name, (const char*)buffer.Data(), buffer.Size());
 	}
+	void OpenMem(const char *name, TArray<uint8_t> &&buffer);
 	void OpenString(const char *name, FString buffer);
 	void OpenLumpNum(int lump);
 	void Close();
@@ -104,6 +105,7 @@ protected:
 
 	bool ScriptOpen;
 	FString ScriptBuffer;
+	TArray<uint8_t> ScriptData;	// used instead of ScriptBuffer when the scanner owns the data it was opened with
 	const char *ScriptPtr;
 	const char *ScriptEndPtr;
 	char StringBuffer[MAX_STRING_SIZE];
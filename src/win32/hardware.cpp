@@ -59,6 +59,7 @@ IVideo *Video;
 
 // do not include GL headers here, only declare the necessary functions.
 IVideo *gl_CreateVideo();
+IVideo *null_CreateVideo();
 
 void I_RestartRenderer();
 int currentcanvas = -1;
@@ -129,6 +130,11 @@ void I_InitGraphics ()
 		// are the active app. Huh?
 	}
 
+	if (Args->CheckParm("-nullrenderer"))
+	{
+		Video = null_CreateVideo();
+	}
+	else
 #ifdef HAVE_VULKAN
 	if (vid_enablevulkan == 1)
 	{
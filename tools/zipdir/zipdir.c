@@ -18,7 +18,7 @@
 **
 ****************************************************************************
 **
-** Usage: zipdir [-dfuq] <zip file> <directory> ...
+** Usage: zipdir [-dzlfuq] <zip file> <directory> ...
 **
 ** Given one or more directories, their contents are scanned recursively.
 ** If any files are newer than the zip file or the zip file does not exist,
@@ -53,6 +53,12 @@
 #ifdef PPMD
 #include "../../ppmd/PPMd.h"
 #endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif
 
 // MACROS ------------------------------------------------------------------
 
@@ -92,7 +98,9 @@ static unsigned int LittleLong(unsigned int x)
 #define METHOD_DEFLATE	8
 #define METHOD_BZIP2	12
 #define METHOD_LZMA		14
+#define METHOD_ZSTD		93
 #define METHOD_PPMD		98
+#define METHOD_LZ4		1339	// not assigned by the zip appnote; only GZDoom reads it
 
 // Buffer size for central directory search
 #define BUFREADCOMMENT	(0x400)
@@ -134,6 +142,7 @@ typedef struct compressor_s
 {
 	int (*compress)(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen);
 	int method;
+	int explicit_only;	// only used when selected on the command line
 } compressor_t;
 
 typedef unsigned int UINT32;
@@ -220,6 +229,12 @@ int compress_lzma(Byte *out, unsigned int *outlen, const Byte *in, unsigned int
 int compress_bzip2(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen);
 int compress_ppmd(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen);
 int compress_deflate(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen);
+#ifdef HAVE_ZSTD
+int compress_zstd(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen);
+#endif
+#ifdef HAVE_LZ4
+int compress_lz4(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen);
+#endif
 BYTE *find_central_dir(FILE *fin);
 CentralDirectoryEntry *find_file_in_zip(BYTE *dir, const char *path, unsigned int len, unsigned int crc, short date, short time);
 int copy_zip_file(FILE *zip, file_entry_t *file, FILE *ozip, CentralDirectoryEntry *dirent);
@@ -233,7 +248,7 @@ static void SzFree(ISzAllocPtr p, void *address) { p = p; free(address); }
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
-int DeflateOnly;
+int OnlyMethod;
 int UpdateCount;
 int Quiet;
 
@@ -247,13 +262,21 @@ static int no_mem;
 static ISzAlloc Alloc = { SzAlloc, SzFree };
 static compressor_t Compressors[] =
 {
-	{ compress_lzma,	METHOD_LZMA },
-	{ compress_bzip2,	METHOD_BZIP2 },
+	{ compress_lzma,	METHOD_LZMA,	0 },
+	{ compress_bzip2,	METHOD_BZIP2,	0 },
 #ifdef PPMD
-	{ compress_ppmd,	METHOD_PPMD },
+	{ compress_ppmd,	METHOD_PPMD,	0 },
 #endif
-	{ compress_deflate,	METHOD_DEFLATE },
-	{ NULL, 0 }
+	{ compress_deflate,	METHOD_DEFLATE,	0 },
+	// These decompress much faster than the above but most other zip tools
+	// cannot read them, so they are never picked unless explicitly asked for.
+#ifdef HAVE_ZSTD
+	{ compress_zstd,	METHOD_ZSTD,	1 },
+#endif
+#ifdef HAVE_LZ4
+	{ compress_lz4,		METHOD_LZ4,		1 },
+#endif
+	{ NULL, 0, 0 }
 };
 
 // CODE --------------------------------------------------------------------
@@ -275,6 +298,12 @@ void print_usage(const char *cmdname)
 #endif
 	fprintf(stderr, "Usage: %s [options] <zip file> <directory> ...\n"
 					"Options: -d  Use deflate compression only\n"
+#ifdef HAVE_ZSTD
+					"         -z  Use zstd compression only\n"
+#endif
+#ifdef HAVE_LZ4
+					"         -l  Use LZ4 compression only\n"
+#endif
 					"         -f  Force creation of archive\n"
 					"         -u  Only update changed files\n"
 					"         -q  Do not list files\n", cmdname);
@@ -991,7 +1020,7 @@ int append_to_zip(FILE *zip_file, file_sorted_t *filep, FILE *ozip, BYTE *odir)
 	// now.
 	for (i = 0; Compressors[i].compress != NULL; ++i)
 	{
-		if (DeflateOnly && Compressors[i].method != METHOD_DEFLATE)
+		if (OnlyMethod != METHOD_STORED ? Compressors[i].method != OnlyMethod : Compressors[i].explicit_only)
 		{
 			continue;
 		}
@@ -1192,6 +1221,14 @@ const char *method_name(int method)
 	{
 		return "BZip2";
 	}
+	if (method == METHOD_ZSTD)
+	{
+		return "Zstd";
+	}
+	if (method == METHOD_LZ4)
+	{
+		return "LZ4";
+	}
 	sprintf(unkn, "Unk:%03d", method);
 	return unkn;
 }
@@ -1357,6 +1394,74 @@ int compress_deflate(Byte *out, unsigned int *outlen, const Byte *in, unsigned i
 	return err == Z_OK ? 0 : -1;
 }
 
+#ifdef HAVE_ZSTD
+//==========================================================================
+//
+// compress_zstd
+//
+// Returns 0 on success, negative on failure.
+//
+// Writes a single standard zstd frame, which is what method 93 in the
+// zip appnote expects.
+//
+//==========================================================================
+
+int compress_zstd(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen)
+{
+	size_t len = ZSTD_compress(out, *outlen, in, inlen, 19);
+
+	if (ZSTD_isError(len))
+	{
+		return -1;
+	}
+	*outlen = (unsigned int)len;
+	return 0;
+}
+#endif
+
+#ifdef HAVE_LZ4
+//==========================================================================
+//
+// compress_lz4
+//
+// Returns 0 on success, negative on failure.
+//
+// Writes a single LZ4 frame. Unlike the raw block format, the frame
+// carries its own end mark and checksum so the reader can stream it.
+//
+//==========================================================================
+
+int compress_lz4(Byte *out, unsigned int *outlen, const Byte *in, unsigned int inlen)
+{
+	LZ4F_preferences_t prefs;
+	size_t bound, len;
+	void *buf;
+
+	memset(&prefs, 0, sizeof(prefs));
+	prefs.frameInfo.contentSize = inlen;
+	prefs.compressionLevel = 12;
+
+	// LZ4F_compressFrame refuses to work unless the output buffer is big
+	// enough for the worst case, which is always larger than the input.
+	bound = LZ4F_compressFrameBound(inlen, &prefs);
+	buf = malloc(bound);
+	if (buf == NULL)
+	{
+		return -1;
+	}
+	len = LZ4F_compressFrame(buf, bound, in, inlen, &prefs);
+	if (LZ4F_isError(len) || len > *outlen)
+	{
+		free(buf);
+		return -1;
+	}
+	memcpy(out, buf, len);
+	free(buf);
+	*outlen = (unsigned int)len;
+	return 0;
+}
+#endif
+
 //==========================================================================
 //
 // find_central_dir
@@ -1595,8 +1700,20 @@ int main (int argc, char **argv)
 				}
 				else if (argv[i][j] == 'd')
 				{
-					DeflateOnly = 1;
+					OnlyMethod = METHOD_DEFLATE;
+				}
+#ifdef HAVE_ZSTD
+				else if (argv[i][j] == 'z')
+				{
+					OnlyMethod = METHOD_ZSTD;
 				}
+#endif
+#ifdef HAVE_LZ4
+				else if (argv[i][j] == 'l')
+				{
+					OnlyMethod = METHOD_LZ4;
+				}
+#endif
 				else if (argv[i][j] == 'u')
 				{
 					update = 1;